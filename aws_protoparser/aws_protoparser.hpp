@@ -5,8 +5,8 @@
  *//**
  *
  * @file aws_protoparser.hpp
- * @version 1.1.0
- * @date 2015-07-20
+ * @version 1.2.0
+ * @date 2026-10-19
  * @since 2011-11-15
  * @licence Public Domain
  *
@@ -14,6 +14,48 @@
  * or other strings based on a protocol buffer definition (.proto).
  *
  *  Version History
+ *    1.2.0
+ *      2026-10-19
+ *         Numeric/enum conversions no longer throw; malformed values are skipped.
+ *         Fixed null dereference in GetString; repeated fields are skipped.
+ *         Fixed misnamed GetInt32/GetDouble (the old GetFloat(double) and
+ *           GetUInt32(int32_t) overloads still work); TYPE_INT32/TYPE_INT64 accepted.
+ *         Cached per-enum metadata; GetEnumAlias is allocation free and
+ *           enums declared outside the message now work.
+ *         Dump rebuilt on a buffered Writer with pluggable emitters;
+ *           added JSON (protobuf's JSON value mapping), argv (up to 8
+ *           nested levels) and logfmt formats and streaming to a descriptor.
+ *         ParserContext: reusable scratch and message pool; Parse reads argv
+ *           in place and looks fields up through the cached field plan.
+ *         Oneof support: last member given a well-formed value wins without
+ *           intermediate sets;
+ *           Dump visits only the active member; added GetOneofCase.
+ *         SIMD (SSE2/AVX2, runtime selected) structural scanner; ParseBuffer
+ *           for bulk input; nested values accept double-quoted strings.
+ *         LazyConfig: index-only parsing with convert-on-first-use getters
+ *           (results match Parse: nested values merge, malformed ones are skipped).
+ *         ParseCached/ParseBufferCached: opt-in on-disk cache of parsed
+ *           messages keyed by input, prior message contents and schema
+ *           fingerprint, extensions included; entries are private (0600)
+ *           and hold their input, compared on load (POSIX).
+ *         SharedConfigPublisher/Reader: publish one parsed config to many
+ *           processes through POSIX shared memory (seqlock; segments are
+ *           0600 unless a mode is given; readers parse the whole message
+ *           from the mapping, not per field, and remap a grown segment).
+ *         ColumnarSink: parse records straight into typed column buffers
+ *           with validity bitmaps (nested fields as dotted columns).
+ *         Bytes fields accept 'hex:' and 'base64:' values (SSE2/AVX2
+ *           decoding; base64 padding, trailing bits and alphabet are
+ *           checked); the argv and logfmt dumps write them as 'base64:'.
+ *         Extensions: parsed, dumped and read by name or "[full.name]".
+ *         Proto3: 'optional' fields are not treated as oneofs, open enums
+ *           keep unknown numbers, and parsing skips storing default values
+ *           into implicit-presence fields that are still at their default.
+ *         Arguments matching no field are kept (as slices of the input, as
+ *           given) in ParserContext::unknown or via ParseCollectUnknown;
+ *           StoreUnknownArguments passes them on through the message's
+ *           unknown fields.  Vector entries may carry a leading '--'.
+ *
  *    1.1.0
  *      2015-07-20
  *         Rewrite and overhaul to pure header.
@@ -42,6 +84,8 @@
 #include <google/protobuf/extension_set.h>
 #include <google/protobuf/generated_enum_reflection.h>
 #include <google/protobuf/unknown_field_set.h>
+#include <google/protobuf/descriptor.pb.h>
+#include <google/protobuf/io/coded_stream.h>
 
 // String functionality, as C++ is already needed
 // it's better to keep things sane.
@@ -56,15 +100,70 @@
 // stdint (u)intX_t
 #include <stdint.h>
 
+// strtod, strtoll, etc. (non-throwing conversions)
+#include <cstdlib>
+#include <cerrno>
+#include <climits>
+
+// memcpy, strlen, snprintf, DBL_MAX (emitters)
+#include <cstring>
+#include <cstdio>
+#include <cfloat>
+
+// write/_write (streaming output)
+#if defined(_WIN32)
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+// open/mmap/shm_open (parsed-config cache, shared configs; POSIX only)
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+// std::atomic (shared config sequence counter), placement new
+#include <atomic>
+#include <new>
+
+// SIMD structural scanning and bytes decoding (x86 only; define AWS_PROTOPARSER_NO_SIMD to disable).
+#if !defined(AWS_PROTOPARSER_NO_SIMD) && \
+	(defined(__x86_64__) || defined(_M_X64) || \
+	(defined(__i386__) && defined(__SSE2__)) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define AWS_PROTOPARSER_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define AWS_PROTOPARSER_TARGET_AVX2
+#else
+#define AWS_PROTOPARSER_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#else
+#define AWS_PROTOPARSER_X86 0
+#endif
+
 // std::vector
 #include <vector>
 
+// Metadata caches (std::mutex, std::unordered_map)
+#include <mutex>
+#include <unordered_map>
+
+// Per-depth parse scratch (std::deque keeps references stable)
+#include <deque>
+
 // Helpers to keep the code sane and to make maintaining this less painful
 // should anything change.
 #define MESSAGE ::google::protobuf::Message
 #define DESCRIPTOR ::google::protobuf::Descriptor
 #define REFLECTION ::google::protobuf::Reflection
 #define FIELDDESC ::google::protobuf::FieldDescriptor
+#define ENUMDESC ::google::protobuf::EnumDescriptor
+#define ENUMVALUEDESC ::google::protobuf::EnumValueDescriptor
+#define ONEOFDESC ::google::protobuf::OneofDescriptor
 
 namespace aws {
 	namespace protocolparser {
@@ -72,6 +171,462 @@ namespace aws {
 		// Forward
 		inline std::string Dump(MESSAGE *msg, int indent);
 
+#pragma region Conversion
+		namespace detail {
+			/**
+			 * @brief Converts text to a signed 64-bit integer without throwing.
+			 * @in val Text to convert (leading whitespace is skipped, as std::stoll).
+			 * @out out Converted value (untouched on failure).
+			 * @return True if a number was read and is in range; false otherwise.
+			 */
+			inline bool ToInt64(const std::string &val, int64_t &out) {
+				const char *begin = val.c_str();
+				char *end = nullptr;
+				errno = 0;
+				long long v = std::strtoll(begin, &end, 10);
+				if (end == begin || errno == ERANGE) {
+					return false;
+				}
+				out = static_cast<int64_t>(v);
+				return true;
+			}
+
+			/**
+			 * @brief Converts text to a signed 32-bit integer without throwing.
+			 * @in val Text to convert.
+			 * @out out Converted value (untouched on failure).
+			 * @return True if a number was read and is in range; false otherwise.
+			 */
+			inline bool ToInt32(const std::string &val, int32_t &out) {
+				int64_t v = 0;
+				if (!ToInt64(val, v) || v < INT32_MIN || v > INT32_MAX) {
+					return false;
+				}
+				out = static_cast<int32_t>(v);
+				return true;
+			}
+
+			/**
+			 * @brief Converts text to an unsigned 64-bit integer without throwing.
+			 * @in val Text to convert.
+			 * @out out Converted value (untouched on failure).
+			 * @return True if a number was read and is in range; false otherwise.
+			 */
+			inline bool ToUInt64(const std::string &val, uint64_t &out) {
+				const char *begin = val.c_str();
+				char *end = nullptr;
+				errno = 0;
+				unsigned long long v = std::strtoull(begin, &end, 10);
+				if (end == begin || errno == ERANGE) {
+					return false;
+				}
+				out = static_cast<uint64_t>(v);
+				return true;
+			}
+
+			/**
+			 * @brief Converts text to an unsigned 32-bit integer without throwing.
+			 * @in val Text to convert.
+			 * @out out Converted value (untouched on failure).
+			 * @return True if a number was read and is in range; false otherwise.
+			 */
+			inline bool ToUInt32(const std::string &val, uint32_t &out) {
+				uint64_t v = 0;
+				if (!ToUInt64(val, v) || v > UINT32_MAX) {
+					return false;
+				}
+				out = static_cast<uint32_t>(v);
+				return true;
+			}
+
+			/**
+			 * @brief Converts text to a double without throwing.
+			 * @in val Text to convert.
+			 * @out out Converted value (untouched on failure).
+			 * @return True if a number was read and is in range; false otherwise.
+			 */
+			inline bool ToDouble(const std::string &val, double &out) {
+				const char *begin = val.c_str();
+				char *end = nullptr;
+				errno = 0;
+				double v = std::strtod(begin, &end);
+				if (end == begin || errno == ERANGE) {
+					return false;
+				}
+				out = v;
+				return true;
+			}
+
+			/**
+			 * @brief Converts text to a float without throwing.
+			 * @in val Text to convert.
+			 * @out out Converted value (untouched on failure).
+			 * @return True if a number was read and is in range; false otherwise.
+			 */
+			inline bool ToFloat(const std::string &val, float &out) {
+				const char *begin = val.c_str();
+				char *end = nullptr;
+				errno = 0;
+				float v = std::strtof(begin, &end);
+				if (end == begin || errno == ERANGE) {
+					return false;
+				}
+				out = v;
+				return true;
+			}
+
+			/**
+			 * @brief Reads a fixed number of hexadecimal digits.
+			 * @in text Digits (no prefix).
+			 * @in len Number of digits (at most 8).
+			 * @out out Value read (untouched on failure).
+			 * @return True if every character was a hexadecimal digit.
+			 */
+			inline bool ToHexValue(const char *text, size_t len, uint32_t &out) {
+				uint32_t v = 0;
+				for (size_t i = 0; i < len; i++) {
+					char c = text[i];
+					uint32_t d;
+					if (c >= '0' && c <= '9') {
+						d = static_cast<uint32_t>(c - '0');
+					}
+					else if (c >= 'a' && c <= 'f') {
+						d = static_cast<uint32_t>(c - 'a' + 10);
+					}
+					else if (c >= 'A' && c <= 'F') {
+						d = static_cast<uint32_t>(c - 'A' + 10);
+					}
+					else {
+						return false;
+					}
+					v = (v << 4) | d;
+				}
+				out = v;
+				return true;
+			}
+		}
+#pragma endregion
+#pragma region Metadata
+		namespace detail {
+			/**
+			 * @brief Returns process-wide metadata for a descriptor, building it once.
+			 * @in key Descriptor the metadata describes (Value must be constructible from it).
+			 * @return Metadata for key; valid for the life of the process.
+			 *
+			 * Built entries are never freed, so the returned pointer can be kept.
+			 * Each thread keeps its own table in front of the shared one, so once
+			 * warm a lookup takes no lock.  Value's constructor must not request
+			 * another Value (the shared table is locked while it runs).
+			 *
+			 * Entries are keyed by descriptor address and never invalidated, so
+			 * descriptors used here must live for the rest of the process: a
+			 * DescriptorPool (e.g. one built for a dynamic schema) must not be
+			 * destroyed once its messages have been parsed, dumped or read
+			 * through this header.  The shared table is deliberately never
+			 * destroyed, so the entries stay reachable at exit (no leak reports).
+			 */
+			template <typename Value, typename Key>
+			inline const Value *CachedMetadata(const Key *key) {
+				static std::mutex *lock = new std::mutex;
+				static std::unordered_map<const Key *, const Value *> *shared =
+					new std::unordered_map<const Key *, const Value *>;
+				thread_local std::unordered_map<const Key *, const Value *> local;
+
+				auto it = local.find(key);
+				if (it != local.end()) {
+					return it->second;
+				}
+
+				const Value *value = nullptr;
+				{
+					std::lock_guard<std::mutex> guard(*lock);
+					const Value *&slot = (*shared)[key];
+					if (slot == nullptr) {
+						slot = new Value(key);
+					}
+					value = slot;
+				}
+				local.emplace(key, value);
+				return value;
+			}
+
+			/**
+			 * @brief Precomputed lookup data for an enum type.
+			 *
+			 * Values are held in a table indexed by (number - min_number), holding
+			 * the first value declared for each number (i.e. the primary name when
+			 * allow_alias is used).  Enums with a very sparse numbering fall back to
+			 * the descriptor's own lookup.
+			 */
+			struct EnumMetadata {
+				const ENUMDESC *desc;
+				int32_t min_number;
+				std::vector<const ENUMVALUEDESC *> by_number;
+
+				// Open (proto3) enums also hold numbers they do not declare.
+				bool open;
+
+				explicit EnumMetadata(const ENUMDESC *enum_desc)
+					: desc(enum_desc), min_number(0) {
+#if GOOGLE_PROTOBUF_VERSION >= 4022000
+					open = !desc->is_closed();
+#else
+					open = desc->file()->syntax() == ::google::protobuf::FileDescriptor::SYNTAX_PROTO3;
+#endif
+					int count = desc->value_count();
+					if (count == 0) {
+						return;
+					}
+
+					int32_t lo = desc->value(0)->number();
+					int32_t hi = lo;
+					for (int i = 1; i < count; i++) {
+						int32_t n = desc->value(i)->number();
+						lo = n < lo ? n : lo;
+						hi = n > hi ? n : hi;
+					}
+
+					// Keep the table when it is at most a few times larger than the
+					// number of values; otherwise use FindValueByNumber.
+					int64_t span = static_cast<int64_t>(hi) - lo + 1;
+					if (span > 4 * static_cast<int64_t>(count) + 64) {
+						return;
+					}
+
+					min_number = lo;
+					by_number.assign(static_cast<size_t>(span), nullptr);
+					for (int i = 0; i < count; i++) {
+						const ENUMVALUEDESC *v = desc->value(i);
+						const ENUMVALUEDESC *&slot = by_number[v->number() - lo];
+						if (slot == nullptr) {
+							slot = v;
+						}
+					}
+				}
+
+				/**
+				 * @brief Finds the (first) value for a number.
+				 * @in number Enum number.
+				 * @return Value descriptor, or nullptr if the number is not defined.
+				 */
+				const ENUMVALUEDESC *FindValueByNumber(int32_t number) const {
+					if (by_number.empty()) {
+						return desc->FindValueByNumber(number);
+					}
+					int64_t index = static_cast<int64_t>(number) - min_number;
+					if (index < 0 || index >= static_cast<int64_t>(by_number.size())) {
+						return nullptr;
+					}
+					return by_number[static_cast<size_t>(index)];
+				}
+			};
+
+			/**
+			 * @brief Gets the cached enum metadata for an enum field.
+			 * @in field Field descriptor (must be TYPE_ENUM).
+			 * @return Metadata shared by every field using the same enum type.
+			 */
+			inline const EnumMetadata *GetEnumMetadata(const FIELDDESC *field) {
+				return CachedMetadata<EnumMetadata>(field->enum_type());
+			}
+
+			/**
+			 * @brief Shared empty string, returned by reference on failure.
+			 */
+			inline const std::string &EmptyString() {
+				static const std::string empty;
+				return empty;
+			}
+
+			/**
+			 * @brief Gets the oneof a field was declared in.
+			 * @return The oneof, or nullptr (also for the synthetic oneof wrapping
+			 *   a proto3 'optional' field).
+			 */
+			inline const ONEOFDESC *RealOneof(const FIELDDESC *field) {
+#if GOOGLE_PROTOBUF_VERSION >= 3012000
+				return field->real_containing_oneof();
+#else
+				return field->containing_oneof();
+#endif
+			}
+
+			/**
+			 * @brief Checks if a field tracks whether it is set.
+			 * @return False for repeated fields and proto3 scalars without
+			 *   'optional', where unset and default are the same thing.
+			 */
+			inline bool HasPresence(const FIELDDESC *field) {
+#if GOOGLE_PROTOBUF_VERSION >= 3012000
+				return field->has_presence();
+#else
+				return !field->is_repeated() &&
+					(field->file()->syntax() != ::google::protobuf::FileDescriptor::SYNTAX_PROTO3 ||
+					field->cpp_type() == FIELDDESC::CPPTYPE_MESSAGE ||
+					field->containing_oneof() != nullptr);
+#endif
+			}
+
+			/**
+			 * @brief A field as seen by the precomputed field plan.
+			 */
+			struct FieldPlanEntry {
+				const FIELDDESC *field;
+				FIELDDESC::Type type;
+
+				// Name as written out: the field name, or "[full.name]" for extensions.
+				std::string name;
+
+				// TYPE_ENUM only; nullptr otherwise.
+				const EnumMetadata *enum_meta;
+
+				// Index of the containing oneof, or -1.
+				int oneof_index;
+
+				// Proto3 scalar without presence: storing the default while the
+				// field is at its default changes nothing.
+				bool implicit_presence;
+			};
+
+			/**
+			 * @brief Precomputed per-message walk order and field information.
+			 *
+			 * Holds every non-repeated field in declaration order so walkers
+			 * (emitters, parsers) do not need to go back through the descriptor.
+			 * Nested message plans are fetched on use, which keeps recursive
+			 * message types finite.
+			 *
+			 * Extensions known to the descriptor's pool when the plan is built
+			 * follow the regular fields (by number).  They are indexed by their
+			 * own name (unless a regular field or earlier extension has it) and
+			 * by "[full.name]".  Plans are built once and cached for the life of
+			 * the process, so an extension added to the pool afterwards is never
+			 * seen (re-listing the pool's extensions on every lookup would cost
+			 * an allocation per parse).
+			 */
+			struct FieldPlan {
+				const DESCRIPTOR *desc;
+				std::vector<FieldPlanEntry> fields;
+				int oneof_count;
+
+				// Index into fields by name and by lowercase name.
+				std::unordered_map<std::string, size_t> by_name;
+				std::unordered_map<std::string, size_t> by_lowercase_name;
+
+				explicit FieldPlan(const DESCRIPTOR *message_desc)
+					: desc(message_desc), oneof_count(message_desc->oneof_decl_count()) {
+					int count = desc->field_count();
+					fields.reserve(static_cast<size_t>(count));
+					for (int i = 0; i < count; i++) {
+						Add(desc->field(i));
+					}
+
+					if (desc->extension_range_count() > 0) {
+						std::vector<const FIELDDESC *> extensions;
+						desc->file()->pool()->FindAllExtensions(desc, &extensions);
+						std::sort(extensions.begin(), extensions.end(),
+							[](const FIELDDESC *a, const FIELDDESC *b) { return a->number() < b->number(); });
+						for (size_t i = 0; i < extensions.size(); i++) {
+							Add(extensions[i]);
+						}
+					}
+				}
+
+				/**
+				 * @brief Appends a (non-repeated) field or extension and indexes it.
+				 */
+				void Add(const FIELDDESC *field) {
+					if (field->is_repeated()) {
+						return;
+					}
+
+					FieldPlanEntry entry;
+					entry.field = field;
+					entry.type = field->type();
+					entry.name = field->name();
+					entry.enum_meta = nullptr;
+					if (entry.type == FIELDDESC::TYPE_ENUM) {
+						entry.enum_meta = GetEnumMetadata(field);
+					}
+					entry.oneof_index = -1;
+					if (RealOneof(field) != nullptr) {
+						entry.oneof_index = RealOneof(field)->index();
+					}
+					entry.implicit_presence = !HasPresence(field);
+
+					by_name.emplace(field->name(), fields.size());
+					by_lowercase_name.emplace(field->lowercase_name(), fields.size());
+					if (field->is_extension()) {
+						entry.name = "[" + field->full_name() + "]";
+						std::string lowercase = entry.name;
+						std::transform(lowercase.begin(), lowercase.end(), lowercase.begin(), ::tolower);
+						by_name.emplace(entry.name, fields.size());
+						by_lowercase_name.emplace(lowercase, fields.size());
+					}
+					fields.push_back(entry);
+				}
+
+				/**
+				 * @brief Finds a field by name.
+				 * @in name Field name (already lowercased if lowercase is set).
+				 * @in lowercase If true name is matched against lowercase names.
+				 * @return Plan entry, or nullptr if there is no such (non-repeated) field.
+				 */
+				const FieldPlanEntry *Find(const std::string &name, bool lowercase = false) const {
+					const std::unordered_map<std::string, size_t> &index =
+						lowercase ? by_lowercase_name : by_name;
+					std::unordered_map<std::string, size_t>::const_iterator it = index.find(name);
+					if (it == index.end()) {
+						return nullptr;
+					}
+					return &fields[it->second];
+				}
+			};
+
+			/**
+			 * @brief Gets the cached field plan for a message type.
+			 * @in desc Message descriptor.
+			 * @return Plan shared by every message of this type.
+			 */
+			inline const FieldPlan *GetFieldPlan(const DESCRIPTOR *desc) {
+				return CachedMetadata<FieldPlan>(desc);
+			}
+
+			/**
+			 * @brief Finds a field by name, including registered extensions.
+			 * @in desc Message descriptor.
+			 * @in name Field name, extension name or "[full.extension.name]".
+			 * @return Field descriptor, or nullptr if there is no such field.
+			 */
+			inline const FIELDDESC *FindField(const DESCRIPTOR *desc, const std::string &name) {
+				const FIELDDESC *field = desc->FindFieldByName(name);
+				if (field == nullptr && desc->extension_range_count() > 0) {
+					const FieldPlanEntry *entry = GetFieldPlan(desc)->Find(name);
+					if (entry != nullptr) {
+						field = entry->field;
+					}
+				}
+				return field;
+			}
+
+			/**
+			 * @brief Checks if a field is a oneof member while another member is set.
+			 * @in msg Message holding the field.
+			 * @in field Field descriptor.
+			 * @return True if a different member of the field's oneof is active.
+			 */
+			inline bool IsInactiveOneofMember(const MESSAGE &msg, const FIELDDESC *field) {
+				const ONEOFDESC *oneof = RealOneof(field);
+				if (oneof == nullptr) {
+					return false;
+				}
+				const FIELDDESC *active =
+					msg.GetReflection()->GetOneofFieldDescriptor(msg, oneof);
+				return active != nullptr && active != field;
+			}
+		}
+#pragma endregion
+
 #pragma region Boolean
 		/**
 		* @brief Sets the value of a field (boolean)
@@ -86,9 +641,9 @@ namespace aws {
 			bool rv = false;
 			const DESCRIPTOR *desc = msg->GetDescriptor();
 			const REFLECTION *refl = msg->GetReflection();
-			const FIELDDESC *field = desc->FindFieldByName(field_name);
+			const FIELDDESC *field = detail::FindField(desc, field_name);
 
-			if (field != nullptr) {
+			if (field != nullptr && !field->is_repeated()) {
 				if (field->type() == FIELDDESC::TYPE_BOOL) {
 					refl->SetBool(msg, field, value);
 					rv = true;
@@ -112,12 +667,13 @@ namespace aws {
 
 			const DESCRIPTOR *desc = msg->GetDescriptor();
 			const REFLECTION *refl = msg->GetReflection();
-			const FIELDDESC *field = desc->FindFieldByName(field_name);
+			const FIELDDESC *field = detail::FindField(desc, field_name);
 
-			if (field != nullptr) {
+			if (field != nullptr && !field->is_repeated()) {
 				if (field->type() == FIELDDESC::TYPE_BOOL) {
 					out = refl->GetBool(*msg, field);
-					if (out == false && set_if_missing) {
+					if (out == false && set_if_missing &&
+						!detail::IsInactiveOneofMember(*msg, field)) {
 						refl->SetBool(msg, field, default_value);
 						out = default_value;
 					}
@@ -140,9 +696,9 @@ namespace aws {
 			bool rv = false;
 			const DESCRIPTOR *desc = msg->GetDescriptor();
 			const REFLECTION *refl = msg->GetReflection();
-			const FIELDDESC *field = desc->FindFieldByName(field_name);
+			const FIELDDESC *field = detail::FindField(desc, field_name);
 
-			if (field != nullptr) {
+			if (field != nullptr && !field->is_repeated()) {
 				if (field->type() == FIELDDESC::TYPE_FLOAT) {
 					refl->SetFloat(msg, field, value);
 					rv = true;
@@ -166,12 +722,13 @@ namespace aws {
 
 			const DESCRIPTOR *desc = msg->GetDescriptor();
 			const REFLECTION *refl = msg->GetReflection();
-			const FIELDDESC *field = desc->FindFieldByName(field_name);
+			const FIELDDESC *field = detail::FindField(desc, field_name);
 
-			if (field != nullptr) {
+			if (field != nullptr && !field->is_repeated()) {
 				if (field->type() == FIELDDESC::TYPE_FLOAT) {
 					out = refl->GetFloat(*msg, field);
-					if (out == 0.0f && set_if_missing) {
+					if (out == 0.0f && set_if_missing &&
+						!detail::IsInactiveOneofMember(*msg, field)) {
 						refl->SetFloat(msg, field, default_value);
 						out = default_value;
 					}
@@ -190,13 +747,13 @@ namespace aws {
 		 *
 		 * Failure should typically only be because the field is missing.
 		 */
-		inline bool SetDouble(MESSAGE *msg, std::string field_name, float value) {
+		inline bool SetDouble(MESSAGE *msg, std::string field_name, double value) {
 			bool rv = false;
 			const DESCRIPTOR *desc = msg->GetDescriptor();
 			const REFLECTION *refl = msg->GetReflection();
-			const FIELDDESC *field = desc->FindFieldByName(field_name);
+			const FIELDDESC *field = detail::FindField(desc, field_name);
 
-			if (field != nullptr) {
+			if (field != nullptr && !field->is_repeated()) {
 				if (field->type() == FIELDDESC::TYPE_DOUBLE) {
 					refl->SetDouble(msg, field, value);
 					rv = true;
@@ -213,19 +770,20 @@ namespace aws {
 		 * @in set_if_missing If true it will attempt to set the field if the value is uninitialised.
 		 * @return Value of the field (or default_value if missing).
 		 */
-		inline double GetFloat(MESSAGE *msg, std::string field_name,
-			double default_value = 0.0f, bool set_if_missing = false) {
+		inline double GetDouble(MESSAGE *msg, std::string field_name,
+			double default_value = 0.0, bool set_if_missing = false) {
 
-			double out = 0.0f;
+			double out = 0.0;
 
 			const DESCRIPTOR *desc = msg->GetDescriptor();
 			const REFLECTION *refl = msg->GetReflection();
-			const FIELDDESC *field = desc->FindFieldByName(field_name);
+			const FIELDDESC *field = detail::FindField(desc, field_name);
 
-			if (field != nullptr) {
+			if (field != nullptr && !field->is_repeated()) {
 				if (field->type() == FIELDDESC::TYPE_DOUBLE) {
 					out = refl->GetDouble(*msg, field);
-					if (out == 0.0f && set_if_missing) {
+					if (out == 0.0 && set_if_missing &&
+						!detail::IsInactiveOneofMember(*msg, field)) {
 						refl->SetDouble(msg, field, default_value);
 						out = default_value;
 					}
@@ -233,6 +791,23 @@ namespace aws {
 			}
 			return out;
 		}
+
+		/**
+		 * @brief Gets the value of a field (double).
+		 * @in msg Protobuf Message object
+		 * @in field_name Name of field (as string).
+		 * @in default_value Default value.
+		 * @in set_if_missing If true it will attempt to set the field if the value is uninitialised.
+		 * @return Value of the field (or default_value if missing).
+		 *
+		 * Before 1.2.0 GetDouble was spelled as this overload of GetFloat;
+		 * it is kept, unchanged, so those calls keep reading double fields.
+		 */
+		inline double GetFloat(MESSAGE *msg, std::string field_name,
+			double default_value, bool set_if_missing = false) {
+
+			return GetDouble(msg, field_name, default_value, set_if_missing);
+		}
 #pragma endregion
 #pragma region Int32
 		/**
@@ -249,11 +824,12 @@ namespace aws {
 			bool rv = false;
 			const DESCRIPTOR *desc = msg->GetDescriptor();
 			const REFLECTION *refl = msg->GetReflection();
-			const FIELDDESC *field = desc->FindFieldByName(field_name);
+			const FIELDDESC *field = detail::FindField(desc, field_name);
 
-			if (field != nullptr) {
+			if (field != nullptr && !field->is_repeated()) {
 				if (field->type() == FIELDDESC::TYPE_SFIXED32 ||
-					field->type() == FIELDDESC::TYPE_SINT32) {
+					field->type() == FIELDDESC::TYPE_SINT32 ||
+					field->type() == FIELDDESC::TYPE_INT32) {
 					refl->SetInt32(msg, field, value);
 					rv = true;
 				}
@@ -262,27 +838,29 @@ namespace aws {
 		}
 
 		/**
-		 * @brief Gets the value of a field uint32_t).
+		 * @brief Gets the value of a field (int32_t).
 		 * @in msg Protobuf Message object
 		 * @in field_name Name of field (as string).
-		 * @in default_value Default value (default false)
+		 * @in default_value Default value (default 0)
 		 * @in set_if_missing If true it will attempt to set the field if the value is uninitialised.
 		 * @return Value of the field (or default_value if missing).
 		 */
-		inline int32_t GetUInt32(MESSAGE *msg, std::string field_name,
+		inline int32_t GetInt32(MESSAGE *msg, std::string field_name,
 			int32_t default_value = 0, bool set_if_missing = false) {
 
 			int32_t out = 0;
 
 			const DESCRIPTOR *desc = msg->GetDescriptor();
 			const REFLECTION *refl = msg->GetReflection();
-			const FIELDDESC *field = desc->FindFieldByName(field_name);
+			const FIELDDESC *field = detail::FindField(desc, field_name);
 
-			if (field != nullptr) {
+			if (field != nullptr && !field->is_repeated()) {
 				if (field->type() == FIELDDESC::TYPE_SFIXED32 ||
-					field->type() == FIELDDESC::TYPE_SINT32) {
+					field->type() == FIELDDESC::TYPE_SINT32 ||
+					field->type() == FIELDDESC::TYPE_INT32) {
 					out = refl->GetInt32(*msg, field);
-					if (out == 0 && set_if_missing) {
+					if (out == 0 && set_if_missing &&
+						!detail::IsInactiveOneofMember(*msg, field)) {
 						refl->SetInt32(msg, field, default_value);
 						out = default_value;
 					}
@@ -306,11 +884,12 @@ namespace aws {
 			bool rv = false;
 			const DESCRIPTOR *desc = msg->GetDescriptor();
 			const REFLECTION *refl = msg->GetReflection();
-			const FIELDDESC *field = desc->FindFieldByName(field_name);
+			const FIELDDESC *field = detail::FindField(desc, field_name);
 
-			if (field != nullptr) {
+			if (field != nullptr && !field->is_repeated()) {
 				if (field->type() == FIELDDESC::TYPE_SFIXED64 ||
-					field->type() == FIELDDESC::TYPE_SINT64) {
+					field->type() == FIELDDESC::TYPE_SINT64 ||
+					field->type() == FIELDDESC::TYPE_INT64) {
 					refl->SetInt64(msg, field, value);
 					rv = true;
 				}
@@ -333,13 +912,15 @@ namespace aws {
 
 			const DESCRIPTOR *desc = msg->GetDescriptor();
 			const REFLECTION *refl = msg->GetReflection();
-			const FIELDDESC *field = desc->FindFieldByName(field_name);
+			const FIELDDESC *field = detail::FindField(desc, field_name);
 
-			if (field != nullptr) {
+			if (field != nullptr && !field->is_repeated()) {
 				if (field->type() == FIELDDESC::TYPE_SFIXED64 ||
-					field->type() == FIELDDESC::TYPE_SINT64) {
+					field->type() == FIELDDESC::TYPE_SINT64 ||
+					field->type() == FIELDDESC::TYPE_INT64) {
 					out = refl->GetInt64(*msg, field);
-					if (out == 0 && set_if_missing) {
+					if (out == 0 && set_if_missing &&
+						!detail::IsInactiveOneofMember(*msg, field)) {
 						refl->SetInt64(msg, field, default_value);
 						out = default_value;
 					}
@@ -363,9 +944,9 @@ namespace aws {
 			bool rv = false;
 			const DESCRIPTOR *desc = msg->GetDescriptor();
 			const REFLECTION *refl = msg->GetReflection();
-			const FIELDDESC *field = desc->FindFieldByName(field_name);
+			const FIELDDESC *field = detail::FindField(desc, field_name);
 
-			if (field != nullptr) {
+			if (field != nullptr && !field->is_repeated()) {
 				if (field->type() == FIELDDESC::TYPE_FIXED32 ||
 					field->type() == FIELDDESC::TYPE_UINT32) {
 					refl->SetUInt32(msg, field, value);
@@ -390,13 +971,14 @@ namespace aws {
 
 			const DESCRIPTOR *desc = msg->GetDescriptor();
 			const REFLECTION *refl = msg->GetReflection();
-			const FIELDDESC *field = desc->FindFieldByName(field_name);
+			const FIELDDESC *field = detail::FindField(desc, field_name);
 
-			if (field != nullptr) {
+			if (field != nullptr && !field->is_repeated()) {
 				if (field->type() == FIELDDESC::TYPE_FIXED32 ||
 					field->type() == FIELDDESC::TYPE_UINT32) {
 					out = refl->GetUInt32(*msg, field);
-					if (out == 0 && set_if_missing) {
+					if (out == 0 && set_if_missing &&
+						!detail::IsInactiveOneofMember(*msg, field)) {
 						refl->SetUInt32(msg, field, default_value);
 						out = default_value;
 					}
@@ -404,6 +986,40 @@ namespace aws {
 			}
 			return out;
 		}
+
+		/**
+		 * @brief Gets the value of a field (sint32/sfixed32).
+		 * @in msg Protobuf Message object
+		 * @in field_name Name of field (as string).
+		 * @in default_value Default value.
+		 * @in set_if_missing If true it will attempt to set the field if the value is uninitialised.
+		 * @return Value of the field (or default_value if missing).
+		 *
+		 * Before 1.2.0 GetInt32 was spelled as this overload of GetUInt32;
+		 * it is kept, reading the same field types as it did then.
+		 */
+		inline int32_t GetUInt32(MESSAGE *msg, std::string field_name,
+			int32_t default_value, bool set_if_missing = false) {
+
+			int32_t out = 0;
+
+			const DESCRIPTOR *desc = msg->GetDescriptor();
+			const REFLECTION *refl = msg->GetReflection();
+			const FIELDDESC *field = detail::FindField(desc, field_name);
+
+			if (field != nullptr && !field->is_repeated()) {
+				if (field->type() == FIELDDESC::TYPE_SFIXED32 ||
+					field->type() == FIELDDESC::TYPE_SINT32) {
+					out = refl->GetInt32(*msg, field);
+					if (out == 0 && set_if_missing &&
+						!detail::IsInactiveOneofMember(*msg, field)) {
+						refl->SetInt32(msg, field, default_value);
+						out = default_value;
+					}
+				}
+			}
+			return out;
+		}
 #pragma endregion
 #pragma region UInt64
 		/**
@@ -416,13 +1032,13 @@ namespace aws {
 		 * Failure should typically only be because the field is missing.
 		 */
 		inline bool SetUInt64(MESSAGE *msg,
-			std::string field_name, uint32_t value) {
+			std::string field_name, uint64_t value) {
 			bool rv = false;
 			const DESCRIPTOR *desc = msg->GetDescriptor();
 			const REFLECTION *refl = msg->GetReflection();
-			const FIELDDESC *field = desc->FindFieldByName(field_name);
+			const FIELDDESC *field = detail::FindField(desc, field_name);
 
-			if (field != nullptr) {
+			if (field != nullptr && !field->is_repeated()) {
 				if (field->type() == FIELDDESC::TYPE_FIXED64 ||
 					field->type() == FIELDDESC::TYPE_UINT64) {
 					refl->SetUInt64(msg, field, value);
@@ -447,13 +1063,14 @@ namespace aws {
 
 			const DESCRIPTOR *desc = msg->GetDescriptor();
 			const REFLECTION *refl = msg->GetReflection();
-			const FIELDDESC *field = desc->FindFieldByName(field_name);
+			const FIELDDESC *field = detail::FindField(desc, field_name);
 
-			if (field != nullptr) {
+			if (field != nullptr && !field->is_repeated()) {
 				if (field->type() == FIELDDESC::TYPE_FIXED64 ||
 					field->type() == FIELDDESC::TYPE_UINT64) {
 					out = refl->GetUInt64(*msg, field);
-					if (out == 0 && set_if_missing) {
+					if (out == 0 && set_if_missing &&
+						!detail::IsInactiveOneofMember(*msg, field)) {
 						refl->SetUInt64(msg, field, default_value);
 						out = default_value;
 					}
@@ -476,9 +1093,9 @@ namespace aws {
 			bool rv = false;
 			const DESCRIPTOR *desc = msg->GetDescriptor();
 			const REFLECTION *refl = msg->GetReflection();
-			const FIELDDESC *field = desc->FindFieldByName(field_name);
+			const FIELDDESC *field = detail::FindField(desc, field_name);
 
-			if (field != nullptr) {
+			if (field != nullptr && !field->is_repeated()) {
 				if (field->type() == FIELDDESC::TYPE_STRING ||
 					field->type() == FIELDDESC::TYPE_BYTES) {
 					refl->SetString(msg, field, value);
@@ -503,14 +1120,17 @@ namespace aws {
 
 			const DESCRIPTOR *desc = msg->GetDescriptor();
 			const REFLECTION *refl = msg->GetReflection();
-			const FIELDDESC *field = desc->FindFieldByName(field_name);
+			const FIELDDESC *field = detail::FindField(desc, field_name);
 
-			if (field->type() == FIELDDESC::TYPE_STRING ||
-				field->type() == FIELDDESC::TYPE_BYTES) {
-				out = refl->GetString(*msg, field);
-				if (out == "" && set_if_missing) {
-					refl->SetString(msg, field, default_value);
-					out = default_value;
+			if (field != nullptr && !field->is_repeated()) {
+				if (field->type() == FIELDDESC::TYPE_STRING ||
+					field->type() == FIELDDESC::TYPE_BYTES) {
+					out = refl->GetString(*msg, field);
+					if (out == "" && set_if_missing &&
+						!detail::IsInactiveOneofMember(*msg, field)) {
+						refl->SetString(msg, field, default_value);
+						out = default_value;
+					}
 				}
 			}
 			return out;
@@ -530,20 +1150,17 @@ namespace aws {
 			bool rv = false;
 			const DESCRIPTOR *desc = msg->GetDescriptor();
 			const REFLECTION *refl = msg->GetReflection();
-			const FIELDDESC *field = desc->FindFieldByName(field_name);
+			const FIELDDESC *field = detail::FindField(desc, field_name);
 
-			if (field != nullptr) {
+			if (field != nullptr && !field->is_repeated()) {
 				if (field->type() == FIELDDESC::TYPE_ENUM) {
-
-					const ::google::protobuf::EnumDescriptor *enum_desc =
-						desc->FindEnumTypeByName(field->enum_type()->name());
-
-					if (enum_desc != nullptr) {
-						const ::google::protobuf::EnumValueDescriptor *enum_value_desc = nullptr;
-						enum_value_desc = enum_desc->FindValueByNumber(value);
-						if (enum_value_desc != nullptr) {
-							refl->SetEnum(msg, field, enum_value_desc);
-						}
+					const detail::EnumMetadata *meta = detail::GetEnumMetadata(field);
+					const ENUMVALUEDESC *enum_value_desc = meta->FindValueByNumber(value);
+					if (enum_value_desc != nullptr) {
+						refl->SetEnum(msg, field, enum_value_desc);
+					}
+					else if (meta->open) {
+						refl->SetEnumValue(msg, field, value);
 					}
 					rv = true;
 				}
@@ -556,7 +1173,7 @@ namespace aws {
 		 * @in msg Protobuf Message object
 		 * @in field_name Name of field (as string).
 		 * @in default_value Default value (default 0)
-		 * @in set_if_missing If true it will attempt to set the field if the value is uninitialised.
+		 * @in set_if_missing If true it will attempt to set the field if the value is unset.
 		 * @return Value of the field (or default_value if missing).
 		 */
 		inline int32_t GetEnum(MESSAGE *msg, std::string field_name,
@@ -566,27 +1183,48 @@ namespace aws {
 
 			const DESCRIPTOR *desc = msg->GetDescriptor();
 			const REFLECTION *refl = msg->GetReflection();
-			const FIELDDESC *field = desc->FindFieldByName(field_name);
+			const FIELDDESC *field = detail::FindField(desc, field_name);
 
-			if (field != nullptr) {
+			if (field != nullptr && !field->is_repeated()) {
 				if (field->type() == FIELDDESC::TYPE_ENUM) {
+					out = refl->GetEnum(*msg, field)->number();
 
-					const ::google::protobuf::EnumDescriptor *enum_desc =
-						desc->FindEnumTypeByName(field->enum_type()->name());
-
-					std::string existing = refl->GetEnum(*msg, field)->name();
-					auto current = enum_desc->FindValueByName(existing);
-					out = current->number();
-
-					if (out == -1 && set_if_missing) {
-						refl->SetInt32(msg, field, default_value);
-						out = default_value;
+					if (set_if_missing && !refl->HasField(*msg, field) &&
+						!detail::IsInactiveOneofMember(*msg, field)) {
+						const detail::EnumMetadata *meta = detail::GetEnumMetadata(field);
+						const ENUMVALUEDESC *enum_value_desc = meta->FindValueByNumber(default_value);
+						if (enum_value_desc != nullptr) {
+							refl->SetEnum(msg, field, enum_value_desc);
+							out = default_value;
+						}
+						else if (meta->open) {
+							refl->SetEnumValue(msg, field, default_value);
+							out = default_value;
+						}
 					}
 				}
 			}
 			return out;
 		}
 
+		/**
+		 * @brief Gets the internal alias of a value (or the first for the value).
+		 * @in field Enum field descriptor.
+		 * @in value (index)
+		 * @return Alias (or "" for failure); owned by the descriptor, no copy is made.
+		 */
+		inline const std::string &GetEnumAlias(const FIELDDESC *field, int32_t value = 0) {
+			if (field == nullptr || field->type() != FIELDDESC::TYPE_ENUM) {
+				return detail::EmptyString();
+			}
+			const ENUMVALUEDESC *inner_value =
+				detail::GetEnumMetadata(field)->FindValueByNumber(value);
+			if (inner_value == nullptr) {
+				return detail::EmptyString();
+			}
+			return inner_value->name();
+		}
+
 		/** 
 		 * @brief Gets the internal alias of a field (or the first for the value).
 		 * @in msg Google Protocol Buffer message.
@@ -594,111 +1232,2359 @@ namespace aws {
 		 * @in value (index)
 		 * @return Alias as string (or "" for failure).
 		 */
-		inline std::string GetEnumAlias(MESSAGE *msg, ::std::string field_name,
+		inline const std::string &GetEnumAlias(MESSAGE *msg, const std::string &field_name,
 			int32_t value = 0) {
+			return GetEnumAlias(detail::FindField(msg->GetDescriptor(), field_name), value);
+		}
 
-			std::string out = "";
-
-			const DESCRIPTOR *desc = msg->GetDescriptor();
-			const REFLECTION *refl = msg->GetReflection();
-			const FIELDDESC *field = desc->FindFieldByName(field_name);
-
-			if (field != nullptr) {
-				if (field->type() == FIELDDESC::TYPE_ENUM) {
-
-					const ::google::protobuf::EnumDescriptor *enum_desc =
-						desc->FindEnumTypeByName(field->enum_type()->name());
-					auto inner_value = enum_desc->FindValueByNumber(value);
-					out = inner_value->name();
-				}
+#pragma endregion
+#pragma region Oneof
+		/**
+		 * @brief Gets the name of the member currently set in a oneof.
+		 * @in msg Google Protocol Buffer message.
+		 * @in oneof_name Name of the oneof.
+		 * @return Field name of the active member (or "" if none is set).
+		 */
+		inline const std::string &GetOneofCase(const MESSAGE &msg, const std::string &oneof_name) {
+			const ONEOFDESC *oneof = msg.GetDescriptor()->FindOneofByName(oneof_name);
+			if (oneof == nullptr) {
+				return detail::EmptyString();
 			}
-
-			return out;
+			const FIELDDESC *active = msg.GetReflection()->GetOneofFieldDescriptor(msg, oneof);
+			if (active == nullptr) {
+				return detail::EmptyString();
+			}
+			return active->name();
 		}
-
 #pragma endregion
 
+#pragma region Writer
 		/**
-		 * @brief Gets the value of a field as a string.
-		 * @in msg Google Protocol Buffer Message.
-		 * @in field_name Name of the field in question.
-		 * @in indent Number of tabs before it (only applies to messages).
-		 * @return Value of the field (or inline message) as string.
+		 * @brief Buffered output used by every emitter.
+		 *
+		 * Output is collected in a fixed internal buffer and handed on in
+		 * blocks, either appended to a std::string or written directly to a
+		 * file descriptor (streaming mode).  Formatting numbers does not
+		 * allocate.
 		 */
-		inline std::string GetAsString(MESSAGE *msg, std::string field_name,
-			int indent = 0) {
-
-			std::string out = "";
-
-			const DESCRIPTOR *desc = msg->GetDescriptor();
-			const REFLECTION *refl = msg->GetReflection();
-			const FIELDDESC *field = desc->FindFieldByName(field_name);
-			if (field != nullptr) {
-				FIELDDESC::Type ftype = field->type();
-				std::stringstream ss;
-
-				switch (ftype) {
-				case FIELDDESC::TYPE_BYTES:
-				case FIELDDESC::TYPE_STRING: {
-					ss << refl->GetString(*msg, field);
-				} break;
-
-				case FIELDDESC::TYPE_BOOL: {
-					ss << refl->GetBool(*msg, field);
-				} break;
-
-				case FIELDDESC::TYPE_DOUBLE: {
-					ss << refl->GetDouble(*msg, field);
-				} break;
+		class Writer {
+		public:
+			/**
+			 * @brief Creates a writer that appends to a string.
+			 * @in out String to append to (must outlive the writer).
+			 */
+			explicit Writer(std::string *out)
+				: used_(0), out_(out), fd_(-1), ok_(true) {
+			}
 
-				case FIELDDESC::TYPE_ENUM: {
-					ss << refl->GetEnum(*msg, field)->full_name();
-				} break;
+			/**
+			 * @brief Creates a writer that streams to a file descriptor.
+			 * @in fd Open, writable file descriptor (not closed by the writer).
+			 */
+			explicit Writer(int fd)
+				: used_(0), out_(nullptr), fd_(fd), ok_(true) {
+			}
 
-				case FIELDDESC::TYPE_FIXED32:
-				case FIELDDESC::TYPE_UINT32: {
-					ss << refl->GetUInt32(*msg, field);
-				} break;
+			~Writer() {
+				Flush();
+			}
 
-				case FIELDDESC::TYPE_FIXED64:
-				case FIELDDESC::TYPE_UINT64: {
-					ss << refl->GetUInt64(*msg, field);
-				} break;
+			/**
+			 * @brief Writes raw bytes.
+			 */
+			void Write(const char *data, size_t len) {
+				if (len > sizeof(buffer_) - used_) {
+					Flush();
+					if (len > sizeof(buffer_)) {
+						Drain(data, len);
+						return;
+					}
+				}
+				memcpy(buffer_ + used_, data, len);
+				used_ += len;
+			}
 
-				case FIELDDESC::TYPE_FLOAT: {
-					ss << refl->GetFloat(*msg, field);
-				} break;
+			void Write(const std::string &str) {
+				Write(str.data(), str.size());
+			}
 
-				case FIELDDESC::TYPE_GROUP: {
-					// unhandled
-				} break;
+			void Write(const char *str) {
+				Write(str, strlen(str));
+			}
 
-				case FIELDDESC::TYPE_MESSAGE:{
-					// Should be done with an immutable type
-					// but this saves a bunch of casting.
-					ss << Dump(refl->MutableMessage(msg, field), indent+1);
-				} break;
+			void Put(char c) {
+				if (used_ == sizeof(buffer_)) {
+					Flush();
+				}
+				buffer_[used_++] = c;
+			}
 
-				case FIELDDESC::TYPE_SFIXED32:
-				case FIELDDESC::TYPE_INT32: {
-					ss << refl->GetInt32(*msg, field);
-				} break;
+			void WriteInt64(int64_t value) {
+				uint64_t magnitude = static_cast<uint64_t>(value);
+				if (value < 0) {
+					Put('-');
+					magnitude = 0 - magnitude;
+				}
+				WriteUInt64(magnitude);
+			}
 
-				case FIELDDESC::TYPE_SFIXED64:
-				case FIELDDESC::TYPE_INT64: {
-					ss << refl->GetInt64(*msg, field);
-				} break;
+			void WriteUInt64(uint64_t value) {
+				char digits[20];
+				size_t n = 0;
+				do {
+					digits[n++] = static_cast<char>('0' + value % 10);
+					value /= 10;
+				} while (value != 0);
+				while (n > 0) {
+					Put(digits[--n]);
+				}
+			}
 
-				default: {
-					ss << "[unimplemented type handler]";
-				} break;
+			/**
+			 * @brief Writes a double in printf's %g style.
+			 * @in value Value to write.
+			 * @in precision Significant digits (6 matches std::ostream).
+			 */
+			void WriteDouble(double value, int precision) {
+				char text[32];
+				int n = snprintf(text, sizeof(text), "%.*g", precision, value);
+				if (n > 0) {
+					Write(text, static_cast<size_t>(n) < sizeof(text) ? static_cast<size_t>(n) : sizeof(text) - 1);
+				}
+			}
 
+			/**
+			 * @brief Writes the shortest %g text which reads back as the same double.
+			 */
+			void WriteDoubleExact(double value) {
+				char text[32];
+				int n = 0;
+				for (int precision = 15; precision <= 17; precision++) {
+					n = snprintf(text, sizeof(text), "%.*g", precision, value);
+					if (strtod(text, nullptr) == value) {
+						break;
+					}
+				}
+				if (n > 0) {
+					Write(text, static_cast<size_t>(n) < sizeof(text) ? static_cast<size_t>(n) : sizeof(text) - 1);
+				}
+			}
 
+			/**
+			 * @brief Writes the shortest %g text which reads back as the same float.
+			 */
+			void WriteFloatExact(float value) {
+				char text[32];
+				int n = 0;
+				for (int precision = 6; precision <= 9; precision++) {
+					n = snprintf(text, sizeof(text), "%.*g", precision, value);
+					if (strtof(text, nullptr) == value) {
+						break;
+					}
+				}
+				if (n > 0) {
+					Write(text, static_cast<size_t>(n) < sizeof(text) ? static_cast<size_t>(n) : sizeof(text) - 1);
 				}
-				out = ss.str();
 			}
-			return out;
-		}
+
+			/**
+			 * @brief Writes bytes as base64 (standard alphabet, '=' padded).
+			 */
+			void WriteBase64(const std::string &value) {
+				static const char alphabet[] =
+					"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+				const unsigned char *src = reinterpret_cast<const unsigned char *>(value.data());
+				size_t len = value.size();
+				size_t i = 0;
+				for (; i + 3 <= len; i += 3) {
+					uint32_t v = (static_cast<uint32_t>(src[i]) << 16) |
+						(static_cast<uint32_t>(src[i + 1]) << 8) | src[i + 2];
+					char out[4] = { alphabet[v >> 18], alphabet[(v >> 12) & 63],
+						alphabet[(v >> 6) & 63], alphabet[v & 63] };
+					Write(out, sizeof(out));
+				}
+				if (i < len) {
+					uint32_t v = static_cast<uint32_t>(src[i]) << 16;
+					if (i + 1 < len) {
+						v |= static_cast<uint32_t>(src[i + 1]) << 8;
+					}
+					char out[4] = { alphabet[v >> 18], alphabet[(v >> 12) & 63],
+						i + 1 < len ? alphabet[(v >> 6) & 63] : '=', '=' };
+					Write(out, sizeof(out));
+				}
+			}
+
+			/**
+			 * @brief Hands buffered output on to the string or descriptor.
+			 * @return False once any write to the descriptor has failed.
+			 */
+			bool Flush() {
+				if (used_ > 0) {
+					Drain(buffer_, used_);
+					used_ = 0;
+				}
+				return ok_;
+			}
+
+			/**
+			 * @return False if writing to the descriptor has failed.
+			 */
+			bool ok() const {
+				return ok_;
+			}
+
+		private:
+			void Drain(const char *data, size_t len) {
+				if (out_ != nullptr) {
+					out_->append(data, len);
+					return;
+				}
+				while (ok_ && len > 0) {
+#if defined(_WIN32)
+					int n = _write(fd_, data, static_cast<unsigned int>(len));
+#else
+					ssize_t n = ::write(fd_, data, len);
+#endif
+					if (n < 0) {
+						if (errno == EINTR) {
+							continue;
+						}
+						ok_ = false;
+						break;
+					}
+					data += n;
+					len -= static_cast<size_t>(n);
+				}
+			}
+
+			Writer(const Writer &);
+			Writer &operator=(const Writer &);
+
+			char buffer_[4096];
+			size_t used_;
+			std::string *out_;
+			int fd_;
+			bool ok_;
+		};
+#pragma endregion
+#pragma region Emitters
+		namespace detail {
+			/**
+			 * @brief Writes a scalar value.
+			 * @in w Destination.
+			 * @in msg Message holding the field.
+			 * @in entry Field to write.
+			 * @in exact If true floats round-trip (shortest form), bools are true/false and enums
+			 *   use their short name; otherwise std::ostream's formatting is used.
+			 * @in scratch Backing store for GetStringReference.
+			 */
+			inline void WriteValue(Writer &w, const MESSAGE &msg, const FieldPlanEntry &entry,
+				bool exact, std::string *scratch) {
+				const REFLECTION *refl = msg.GetReflection();
+				const FIELDDESC *field = entry.field;
+
+				switch (entry.type) {
+				case FIELDDESC::TYPE_BOOL: {
+					bool value = refl->GetBool(msg, field);
+					if (exact) {
+						w.Write(value ? "true" : "false");
+					}
+					else {
+						w.Put(value ? '1' : '0');
+					}
+				} break;
+
+				case FIELDDESC::TYPE_DOUBLE: {
+					if (exact) {
+						w.WriteDoubleExact(refl->GetDouble(msg, field));
+					}
+					else {
+						w.WriteDouble(refl->GetDouble(msg, field), 6);
+					}
+				} break;
+
+				case FIELDDESC::TYPE_FLOAT: {
+					if (exact) {
+						w.WriteFloatExact(refl->GetFloat(msg, field));
+					}
+					else {
+						w.WriteDouble(refl->GetFloat(msg, field), 6);
+					}
+				} break;
+
+				case FIELDDESC::TYPE_ENUM: {
+					// Open enums may hold numbers without a name; write those as is.
+					int number = refl->GetEnumValue(msg, field);
+					const ENUMVALUEDESC *value = entry.enum_meta->FindValueByNumber(number);
+					if (value == nullptr) {
+						w.WriteInt64(number);
+					}
+					else {
+						w.Write(exact ? value->name() : value->full_name());
+					}
+				} break;
+
+				case FIELDDESC::TYPE_FIXED32:
+				case FIELDDESC::TYPE_UINT32: {
+					w.WriteUInt64(refl->GetUInt32(msg, field));
+				} break;
+
+				case FIELDDESC::TYPE_FIXED64:
+				case FIELDDESC::TYPE_UINT64: {
+					w.WriteUInt64(refl->GetUInt64(msg, field));
+				} break;
+
+				case FIELDDESC::TYPE_SFIXED32:
+				case FIELDDESC::TYPE_SINT32:
+				case FIELDDESC::TYPE_INT32: {
+					w.WriteInt64(refl->GetInt32(msg, field));
+				} break;
+
+				case FIELDDESC::TYPE_SFIXED64:
+				case FIELDDESC::TYPE_SINT64:
+				case FIELDDESC::TYPE_INT64: {
+					w.WriteInt64(refl->GetInt64(msg, field));
+				} break;
+
+				case FIELDDESC::TYPE_BYTES:
+				case FIELDDESC::TYPE_STRING: {
+					w.Write(refl->GetStringReference(msg, field, scratch));
+				} break;
+
+				default: break;
+				}
+			}
+		}
+
+		/**
+		 * @brief Output formats available through Dump.
+		 */
+		enum DumpFormat {
+			// Tab-indented, one field per line (the original Dump format).
+			DUMP_HUMAN,
+
+			// A JSON object keyed by field name; set fields only.
+			DUMP_JSON,
+
+			// One '--key=value' argument per line, as accepted by Parse.
+			DUMP_ARGV,
+
+			// A single 'key=value key.nested=value' line (logfmt).
+			DUMP_LOGFMT
+		};
+
+		/**
+		 * @brief Receives the fields of a message from Emit.
+		 *
+		 * Implement this to add an output format; the walk order and the
+		 * writer are shared by all formats.
+		 */
+		class Emitter {
+		public:
+			explicit Emitter(Writer &writer) : w(writer), depth(0) {
+			}
+
+			virtual ~Emitter() {
+			}
+
+			/**
+			 * @brief True to visit fields which are not set (human output).
+			 */
+			virtual bool VisitUnset() const {
+				return false;
+			}
+
+			virtual void BeginMessage() {
+			}
+
+			virtual void EndMessage() {
+			}
+
+			/**
+			 * @brief Called before the fields of a nested message are visited.
+			 */
+			virtual void BeginNested(const detail::FieldPlanEntry &entry) = 0;
+
+			/**
+			 * @brief Called after the fields of a nested message are visited.
+			 */
+			virtual void EndNested(const detail::FieldPlanEntry &entry) = 0;
+
+			/**
+			 * @brief Called for each non-message field.
+			 */
+			virtual void Scalar(const MESSAGE &msg,
+				const detail::FieldPlanEntry &entry) = 0;
+
+		protected:
+			/**
+			 * @brief Writes a scalar value (see detail::WriteValue).
+			 */
+			void WriteValue(const MESSAGE &msg, const detail::FieldPlanEntry &entry,
+				bool exact) {
+				detail::WriteValue(w, msg, entry, exact, &scratch);
+			}
+
+			/**
+			 * @brief Writes a value in double quotes, escaping quotes, backslashes
+			 *   and control characters with C-style escapes.
+			 * @in value Value to write.
+			 * @in levels Number of quoted values the output is nested in (see
+			 *   WriteEscaped).
+			 */
+			void WriteQuoted(const std::string &value, int levels = 0) {
+				WriteEscaped("\"", 1, levels);
+				for (size_t i = 0; i < value.size(); i++) {
+					unsigned char c = static_cast<unsigned char>(value[i]);
+					switch (c) {
+					case '"': WriteEscaped("\\\"", 2, levels); break;
+					case '\\': WriteEscaped("\\\\", 2, levels); break;
+					case '\n': WriteEscaped("\\n", 2, levels); break;
+					case '\r': WriteEscaped("\\r", 2, levels); break;
+					case '\t': WriteEscaped("\\t", 2, levels); break;
+					default: {
+						if (c < 0x20) {
+							static const char hex[] = "0123456789abcdef";
+							char esc[6] = { '\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xF] };
+							WriteEscaped(esc, sizeof(esc), levels);
+						}
+						else {
+							w.Put(static_cast<char>(c));
+						}
+					} break;
+					}
+				}
+				WriteEscaped("\"", 1, levels);
+			}
+
+			/**
+			 * @brief Writes text that sits inside quoted values.
+			 * @in text Text to write.
+			 * @in len Length of text.
+			 * @in levels Number of enclosing quoted values; quotes and
+			 *   backslashes are escaped once per level, so each Unquote peels
+			 *   one level off.  That doubles the backslashes per level, so
+			 *   callers keep levels within ArgvEmitter::MaxNesting().
+			 */
+			void WriteEscaped(const char *text, size_t len, int levels) {
+				if (levels == 0) {
+					w.Write(text, len);
+					return;
+				}
+				for (size_t i = 0; i < len; i++) {
+					if (text[i] == '"' || text[i] == '\\') {
+						for (uint64_t k = 1; k < (static_cast<uint64_t>(1) << levels); k++) {
+							w.Put('\\');
+						}
+					}
+					w.Put(text[i]);
+				}
+			}
+
+			/**
+			 * @brief True if a value must be quoted to survive whitespace splitting.
+			 */
+			static bool NeedsQuotes(const std::string &value) {
+				if (value.empty()) {
+					return true;
+				}
+				for (size_t i = 0; i < value.size(); i++) {
+					unsigned char c = static_cast<unsigned char>(value[i]);
+					if (c <= ' ' || c == '=' || c == '"' || c == '\\') {
+						return true;
+					}
+				}
+				return false;
+			}
+
+			Writer &w;
+			int depth;
+
+			// Backing store for GetStringReference (rarely used).
+			std::string scratch;
+		};
+
+		/**
+		 * @brief Tab-indented output; every field, one per line.
+		 */
+		class HumanEmitter : public Emitter {
+		public:
+			HumanEmitter(Writer &writer, int indent = 0) : Emitter(writer) {
+				depth = indent;
+			}
+
+			bool VisitUnset() const {
+				return true;
+			}
+
+			void BeginNested(const detail::FieldPlanEntry &entry) {
+				Indent();
+				w.Write("[message] `");
+				w.Write(entry.name);
+				w.Write("'\n", 2);
+				depth++;
+			}
+
+			void EndNested(const detail::FieldPlanEntry &) {
+				depth--;
+			}
+
+			void Scalar(const MESSAGE &msg, const detail::FieldPlanEntry &entry) {
+				Indent();
+				w.Put('`');
+				w.Write(entry.name);
+				w.Write("' = `", 5);
+				WriteValue(msg, entry, false);
+				w.Write("'\n", 2);
+			}
+
+		private:
+			void Indent() {
+				for (int j = 0; j < depth; j++) {
+					w.Put('\t');
+				}
+			}
+		};
+
+		/**
+		 * @brief JSON object output keyed by field name; set fields only.
+		 *
+		 * Follows protobuf's JSON mapping for values: enums are written by
+		 * name, 64-bit integers as strings (doubles cannot hold them exactly)
+		 * and bytes as base64.
+		 */
+		class JsonEmitter : public Emitter {
+		public:
+			explicit JsonEmitter(Writer &writer) : Emitter(writer), first(true) {
+			}
+
+			void BeginMessage() {
+				w.Put('{');
+				first = true;
+			}
+
+			void EndMessage() {
+				w.Put('}');
+			}
+
+			void BeginNested(const detail::FieldPlanEntry &entry) {
+				Key(entry);
+				w.Put('{');
+				first = true;
+			}
+
+			void EndNested(const detail::FieldPlanEntry &) {
+				w.Put('}');
+				first = false;
+			}
+
+			void Scalar(const MESSAGE &msg, const detail::FieldPlanEntry &entry) {
+				const REFLECTION *refl = msg.GetReflection();
+
+				switch (entry.type) {
+				case FIELDDESC::TYPE_GROUP: {
+					return;
+				}
+
+				case FIELDDESC::TYPE_STRING: {
+					Key(entry);
+					WriteQuoted(refl->GetStringReference(msg, entry.field, &scratch));
+				} break;
+
+				case FIELDDESC::TYPE_BYTES: {
+					Key(entry);
+					w.Put('"');
+					w.WriteBase64(refl->GetStringReference(msg, entry.field, &scratch));
+					w.Put('"');
+				} break;
+
+				case FIELDDESC::TYPE_FIXED64:
+				case FIELDDESC::TYPE_UINT64:
+				case FIELDDESC::TYPE_SFIXED64:
+				case FIELDDESC::TYPE_SINT64:
+				case FIELDDESC::TYPE_INT64: {
+					Key(entry);
+					w.Put('"');
+					WriteValue(msg, entry, true);
+					w.Put('"');
+				} break;
+
+				case FIELDDESC::TYPE_ENUM: {
+					Key(entry);
+
+					// Numbers an open enum does not declare are written bare.
+					bool named = entry.enum_meta->FindValueByNumber(
+						msg.GetReflection()->GetEnumValue(msg, entry.field)) != nullptr;
+					if (named) {
+						w.Put('"');
+					}
+					WriteValue(msg, entry, true);
+					if (named) {
+						w.Put('"');
+					}
+				} break;
+
+				case FIELDDESC::TYPE_DOUBLE:
+				case FIELDDESC::TYPE_FLOAT: {
+					Key(entry);
+					double value = entry.type == FIELDDESC::TYPE_DOUBLE ?
+						refl->GetDouble(msg, entry.field) : refl->GetFloat(msg, entry.field);
+
+					// JSON has no literal for these; follow protobuf's spelling.
+					if (value != value) {
+						w.Write("\"NaN\"");
+					}
+					else if (value > DBL_MAX) {
+						w.Write("\"Infinity\"");
+					}
+					else if (value < -DBL_MAX) {
+						w.Write("\"-Infinity\"");
+					}
+					else {
+						WriteValue(msg, entry, true);
+					}
+				} break;
+
+				default: {
+					Key(entry);
+					WriteValue(msg, entry, true);
+				} break;
+				}
+			}
+
+		private:
+			void Key(const detail::FieldPlanEntry &entry) {
+				if (!first) {
+					w.Put(',');
+				}
+				first = false;
+				WriteQuoted(entry.name);
+				w.Put(':');
+			}
+
+			bool first;
+		};
+
+		/**
+		 * @brief '--key=value' output, one argument per line; set fields only.
+		 *
+		 * Nested messages are written as one quoted value,
+		 * '--Nested="a=1 b=\"x y\""' (deeper messages escape once more per
+		 * level), which both Parse and ParseBuffer read back.  Escaping doubles
+		 * the backslashes per level, so Dump refuses messages nested deeper
+		 * than MaxNesting().  Top-level
+		 * strings are written as they are, as argv elements; ParseBuffer only
+		 * reads those back if they need no quoting.  Bytes are written as
+		 * 'base64:...', which Parse decodes.
+		 */
+		class ArgvEmitter : public Emitter {
+		public:
+			explicit ArgvEmitter(Writer &writer) : Emitter(writer), first(true) {
+			}
+
+			/**
+			 * @brief Deepest nesting written (a quote in a string there takes 511 backslashes).
+			 */
+			static int MaxNesting() {
+				return 8;
+			}
+
+			void BeginNested(const detail::FieldPlanEntry &entry) {
+				Key(entry);
+				WriteEscaped("\"", 1, depth);
+				depth++;
+				first = true;
+			}
+
+			void EndNested(const detail::FieldPlanEntry &) {
+				depth--;
+				WriteEscaped("\"", 1, depth);
+				if (depth == 0) {
+					w.Put('\n');
+				}
+				first = false;
+			}
+
+			void Scalar(const MESSAGE &msg, const detail::FieldPlanEntry &entry) {
+				if (entry.type == FIELDDESC::TYPE_GROUP) {
+					return;
+				}
+				Key(entry);
+				if (entry.type == FIELDDESC::TYPE_BYTES) {
+					// Base64 needs no quoting or escaping at any depth.
+					w.Write("base64:", 7);
+					w.WriteBase64(msg.GetReflection()->GetStringReference(msg, entry.field, &scratch));
+				}
+				else if (depth > 0 && entry.type == FIELDDESC::TYPE_STRING) {
+					const std::string &value =
+						msg.GetReflection()->GetStringReference(msg, entry.field, &scratch);
+					if (NeedsQuotes(value)) {
+						WriteQuoted(value, depth);
+					}
+					else {
+						w.Write(value);
+					}
+				}
+				else {
+					WriteValue(msg, entry, true);
+				}
+				if (depth == 0) {
+					w.Put('\n');
+				}
+			}
+
+		private:
+			void Key(const detail::FieldPlanEntry &entry) {
+				if (depth == 0) {
+					w.Write("--", 2);
+				}
+				else if (!first) {
+					w.Put(' ');
+				}
+				first = false;
+				w.Write(entry.name);
+				w.Put('=');
+			}
+
+			bool first;
+		};
+
+		/**
+		 * @brief Single-line logfmt output; nested fields use dotted keys.
+		 *
+		 * Bytes are written as "base64:...", as ParseBuffer accepts them.
+		 */
+		class LogfmtEmitter : public Emitter {
+		public:
+			explicit LogfmtEmitter(Writer &writer) : Emitter(writer), first(true) {
+			}
+
+			void EndMessage() {
+				w.Put('\n');
+			}
+
+			void BeginNested(const detail::FieldPlanEntry &entry) {
+				prefix.append(entry.name);
+				prefix.push_back('.');
+			}
+
+			void EndNested(const detail::FieldPlanEntry &entry) {
+				prefix.resize(prefix.size() - entry.name.size() - 1);
+			}
+
+			void Scalar(const MESSAGE &msg, const detail::FieldPlanEntry &entry) {
+				if (entry.type == FIELDDESC::TYPE_GROUP) {
+					return;
+				}
+				if (!first) {
+					w.Put(' ');
+				}
+				first = false;
+				w.Write(prefix);
+				w.Write(entry.name);
+				w.Put('=');
+
+				if (entry.type == FIELDDESC::TYPE_BYTES) {
+					// Quoted, as other values holding '=' (base64 padding) are.
+					w.Write("\"base64:", 8);
+					w.WriteBase64(msg.GetReflection()->GetStringReference(msg, entry.field, &scratch));
+					w.Put('"');
+				}
+				else if (entry.type == FIELDDESC::TYPE_STRING) {
+					const std::string &value =
+						msg.GetReflection()->GetStringReference(msg, entry.field, &scratch);
+					if (NeedsQuotes(value)) {
+						WriteQuoted(value);
+					}
+					else {
+						w.Write(value);
+					}
+				}
+				else {
+					WriteValue(msg, entry, true);
+				}
+			}
+
+		private:
+			std::string prefix;
+			bool first;
+		};
+
+		/**
+		 * @brief Walks a message with the cached field plan, feeding an emitter.
+		 * @in msg Google Protocol Buffer message.
+		 * @in emitter Receives the fields.
+		 */
+		inline void Emit(const MESSAGE &msg, Emitter &emitter) {
+			struct Walker {
+				static void Walk(const MESSAGE &m, Emitter &e) {
+					const detail::FieldPlan *plan = detail::GetFieldPlan(m.GetDescriptor());
+					const REFLECTION *refl = m.GetReflection();
+					bool visit_unset = e.VisitUnset();
+
+					for (size_t i = 0; i < plan->fields.size(); i++) {
+						const detail::FieldPlanEntry &entry = plan->fields[i];
+
+						// Only the active member of a oneof is visited.
+						if (entry.oneof_index >= 0) {
+							if (refl->GetOneofFieldDescriptor(m, entry.field->containing_oneof()) != entry.field) {
+								continue;
+							}
+						}
+						else if (!visit_unset && !refl->HasField(m, entry.field)) {
+							continue;
+						}
+
+						if (entry.type == FIELDDESC::TYPE_MESSAGE) {
+							e.BeginNested(entry);
+							Walk(refl->GetMessage(m, entry.field), e);
+							e.EndNested(entry);
+						}
+						else {
+							e.Scalar(m, entry);
+						}
+					}
+				}
+			};
+
+			emitter.BeginMessage();
+			Walker::Walk(msg, emitter);
+			emitter.EndMessage();
+		}
+
+		namespace detail {
+			/**
+			 * @brief Checks if set message fields nest deeper than limit levels.
+			 */
+			inline bool NestsDeeperThan(const MESSAGE &msg, int limit) {
+				const FieldPlan *plan = GetFieldPlan(msg.GetDescriptor());
+				const REFLECTION *refl = msg.GetReflection();
+				for (size_t i = 0; i < plan->fields.size(); i++) {
+					const FieldPlanEntry &entry = plan->fields[i];
+					if (entry.type != FIELDDESC::TYPE_MESSAGE || !refl->HasField(msg, entry.field)) {
+						continue;
+					}
+					if (limit == 0 || NestsDeeperThan(refl->GetMessage(msg, entry.field), limit - 1)) {
+						return true;
+					}
+				}
+				return false;
+			}
+		}
+
+		/**
+		 * @brief Writes a message in the given format.
+		 * @in msg Google Protocol Buffer message.
+		 * @in writer Destination.
+		 * @in format Output format.
+		 * @return False, with nothing written, for DUMP_ARGV output of a message
+		 *   nested deeper than ArgvEmitter::MaxNesting(); true otherwise.
+		 */
+		inline bool Dump(const MESSAGE &msg, Writer &writer, DumpFormat format) {
+			switch (format) {
+			case DUMP_JSON: {
+				JsonEmitter emitter(writer);
+				Emit(msg, emitter);
+			} break;
+
+			case DUMP_ARGV: {
+				if (detail::NestsDeeperThan(msg, ArgvEmitter::MaxNesting())) {
+					return false;
+				}
+				ArgvEmitter emitter(writer);
+				Emit(msg, emitter);
+			} break;
+
+			case DUMP_LOGFMT: {
+				LogfmtEmitter emitter(writer);
+				Emit(msg, emitter);
+			} break;
+
+			default: {
+				HumanEmitter emitter(writer);
+				Emit(msg, emitter);
+			} break;
+			}
+			return true;
+		}
+
+		/**
+		 * @brief Dumps a Message to string in the given format.
+		 * @in msg Google Protocol Buffer message.
+		 * @in format Output format.
+		 * @return The formatted message; empty if Dump(msg, writer, format)
+		 *   refuses it.
+		 */
+		inline std::string Dump(const MESSAGE &msg, DumpFormat format) {
+			std::string out;
+			{
+				Writer writer(&out);
+				Dump(msg, writer, format);
+			}
+			return out;
+		}
+
+		/**
+		 * @brief Streams a Message straight to a file descriptor.
+		 * @in msg Google Protocol Buffer message.
+		 * @in fd Open, writable file descriptor.
+		 * @in format Output format.
+		 * @return True if everything was written.
+		 */
+		inline bool DumpToFd(const MESSAGE &msg, int fd, DumpFormat format = DUMP_HUMAN) {
+			Writer writer(fd);
+			bool ok = Dump(msg, writer, format);
+			return writer.Flush() && ok;
+		}
+#pragma endregion
+
+		/**
+		 * @brief Dumps a Message to string.
+		 */
+		inline std::string Dump(MESSAGE *msg, int indent = 0) {
+			std::string out;
+			{
+				Writer writer(&out);
+				HumanEmitter emitter(writer, indent);
+				Emit(*msg, emitter);
+			}
+			return out;
+		}
+
+#pragma region Scanner
+		namespace detail {
+			/**
+			 * @brief One 'key=value' token found by TokenizeStructural.
+			 *
+			 * Offsets are relative to the scanned buffer.  eq is the first
+			 * unquoted '=' (or end if there is none); quoted is set when the
+			 * token contains a '"' which must be removed by Unquote.
+			 */
+			struct Token {
+				uint32_t begin;
+				uint32_t eq;
+				uint32_t end;
+				bool quoted;
+			};
+
+			/**
+			 * @brief True for the bytes the structural pass records.
+			 *
+			 * Whitespace (as isspace: ' ' and 0x09-0x0D), '=', '"' and '\\'.
+			 */
+			inline bool IsStructural(unsigned char c) {
+				return c == ' ' || static_cast<unsigned char>(c - 0x09) < 5 ||
+					c == '=' || c == '"' || c == '\\';
+			}
+
+			inline uint32_t CountTrailingZeros(uint64_t bits) {
+#if defined(_MSC_VER)
+				unsigned long index;
+#if defined(_M_X64) || defined(_M_ARM64)
+				_BitScanForward64(&index, bits);
+				return static_cast<uint32_t>(index);
+#else
+				if (static_cast<uint32_t>(bits) != 0) {
+					_BitScanForward(&index, static_cast<uint32_t>(bits));
+					return static_cast<uint32_t>(index);
+				}
+				_BitScanForward(&index, static_cast<uint32_t>(bits >> 32));
+				return static_cast<uint32_t>(index) + 32;
+#endif
+#else
+				return static_cast<uint32_t>(__builtin_ctzll(bits));
+#endif
+			}
+
+			/**
+			 * @brief Appends the offsets of each bit set in a 64-byte block mask.
+			 */
+			inline void FlattenBits(std::vector<uint32_t> &offsets, uint32_t base, uint64_t bits) {
+				while (bits != 0) {
+					offsets.push_back(base + CountTrailingZeros(bits));
+					bits &= bits - 1;
+				}
+			}
+
+			/**
+			 * @brief Records structural offsets one byte at a time.
+			 * @in data Buffer to scan.
+			 * @in begin First offset to scan.
+			 * @in len Length of the buffer.
+			 * @out offsets Offsets are appended here.
+			 */
+			inline void ScanStructuralScalar(const char *data, size_t begin, size_t len,
+				std::vector<uint32_t> &offsets) {
+				for (size_t i = begin; i < len; i++) {
+					if (IsStructural(static_cast<unsigned char>(data[i]))) {
+						offsets.push_back(static_cast<uint32_t>(i));
+					}
+				}
+			}
+
+#if AWS_PROTOPARSER_X86
+			/**
+			 * @brief Structural mask for 16 bytes (SSE2).
+			 */
+			inline uint32_t StructuralMaskSse2(const char *p) {
+				__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+
+				// 0x09-0x0D: (c - 9) <= 4 unsigned, i.e. min(c - 9, 4) == c - 9.
+				__m128i shifted = _mm_sub_epi8(v, _mm_set1_epi8(0x09));
+				__m128i ws = _mm_cmpeq_epi8(_mm_min_epu8(shifted, _mm_set1_epi8(4)), shifted);
+
+				__m128i m = _mm_or_si128(ws, _mm_cmpeq_epi8(v, _mm_set1_epi8(' ')));
+				m = _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8('=')));
+				m = _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8('"')));
+				m = _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8('\\')));
+				return static_cast<uint32_t>(_mm_movemask_epi8(m));
+			}
+
+			/**
+			 * @brief Records structural offsets 64 bytes at a time (SSE2).
+			 */
+			inline void ScanStructuralSse2(const char *data, size_t len,
+				std::vector<uint32_t> &offsets) {
+				size_t i = 0;
+				for (; i + 64 <= len; i += 64) {
+					uint64_t bits =
+						static_cast<uint64_t>(StructuralMaskSse2(data + i)) |
+						(static_cast<uint64_t>(StructuralMaskSse2(data + i + 16)) << 16) |
+						(static_cast<uint64_t>(StructuralMaskSse2(data + i + 32)) << 32) |
+						(static_cast<uint64_t>(StructuralMaskSse2(data + i + 48)) << 48);
+					FlattenBits(offsets, static_cast<uint32_t>(i), bits);
+				}
+				ScanStructuralScalar(data, i, len, offsets);
+			}
+
+			/**
+			 * @brief Structural mask for 32 bytes (AVX2).
+			 */
+			AWS_PROTOPARSER_TARGET_AVX2
+			inline uint32_t StructuralMaskAvx2(const char *p) {
+				__m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+
+				__m256i shifted = _mm256_sub_epi8(v, _mm256_set1_epi8(0x09));
+				__m256i ws = _mm256_cmpeq_epi8(_mm256_min_epu8(shifted, _mm256_set1_epi8(4)), shifted);
+
+				__m256i m = _mm256_or_si256(ws, _mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')));
+				m = _mm256_or_si256(m, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('=')));
+				m = _mm256_or_si256(m, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('"')));
+				m = _mm256_or_si256(m, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\\')));
+				return static_cast<uint32_t>(_mm256_movemask_epi8(m));
+			}
+
+			/**
+			 * @brief Records structural offsets 64 bytes at a time (AVX2).
+			 */
+			AWS_PROTOPARSER_TARGET_AVX2
+			inline void ScanStructuralAvx2(const char *data, size_t len,
+				std::vector<uint32_t> &offsets) {
+				size_t i = 0;
+				for (; i + 64 <= len; i += 64) {
+					uint64_t bits =
+						static_cast<uint64_t>(StructuralMaskAvx2(data + i)) |
+						(static_cast<uint64_t>(StructuralMaskAvx2(data + i + 32)) << 32);
+					FlattenBits(offsets, static_cast<uint32_t>(i), bits);
+				}
+				ScanStructuralScalar(data, i, len, offsets);
+			}
+
+			/**
+			 * @brief Checks (once) whether the CPU and OS support AVX2.
+			 */
+			inline bool CpuHasAvx2() {
+#if defined(_MSC_VER)
+				int info[4];
+				__cpuid(info, 0);
+				if (info[0] < 7) {
+					return false;
+				}
+				__cpuid(info, 1);
+				bool osxsave = (info[2] & (1 << 27)) != 0;
+				bool avx = (info[2] & (1 << 28)) != 0;
+				if (!osxsave || !avx || (_xgetbv(0) & 6) != 6) {
+					return false;
+				}
+				__cpuidex(info, 7, 0);
+				return (info[1] & (1 << 5)) != 0;
+#else
+				__builtin_cpu_init();
+				return __builtin_cpu_supports("avx2") != 0;
+#endif
+			}
+#endif
+
+			/**
+			 * @brief Records the offsets of every structural byte in a buffer.
+			 * @in data Buffer to scan.
+			 * @in len Length of the buffer (less than 4GiB).
+			 * @out offsets Cleared, then filled in ascending order.
+			 *
+			 * Uses AVX2 or SSE2 when available (chosen once, at run time) and a
+			 * byte loop otherwise or when AWS_PROTOPARSER_NO_SIMD is defined.
+			 */
+			inline void ScanStructural(const char *data, size_t len,
+				std::vector<uint32_t> &offsets) {
+				offsets.clear();
+#if AWS_PROTOPARSER_X86
+				static const bool use_avx2 = CpuHasAvx2();
+				if (use_avx2) {
+					ScanStructuralAvx2(data, len, offsets);
+				}
+				else {
+					ScanStructuralSse2(data, len, offsets);
+				}
+#else
+				ScanStructuralScalar(data, 0, len, offsets);
+#endif
+			}
+
+			/**
+			 * @brief Splits a scanned buffer into whitespace separated tokens.
+			 * @in data Buffer that was scanned.
+			 * @in len Length of the buffer.
+			 * @in offsets Structural offsets from ScanStructural.
+			 * @out tokens Cleared, then filled in order.
+			 *
+			 * Double quotes group whitespace (and '=') into a token; inside them
+			 * a backslash escapes the next character.
+			 */
+			inline void TokenizeStructural(const char *data, size_t len,
+				const std::vector<uint32_t> &offsets, std::vector<Token> &tokens) {
+
+				tokens.clear();
+
+				Token token = { 0, 0, 0, false };
+				bool has_eq = false;
+				bool in_quote = false;
+				uint32_t escaped = UINT32_MAX;
+
+				for (size_t i = 0; i < offsets.size(); i++) {
+					uint32_t o = offsets[i];
+					char c = data[o];
+
+					if (o == escaped) {
+						continue;
+					}
+
+					if (in_quote) {
+						if (c == '\\') {
+							escaped = o + 1;
+						}
+						else if (c == '"') {
+							in_quote = false;
+						}
+						continue;
+					}
+
+					if (c == '"') {
+						in_quote = true;
+						token.quoted = true;
+					}
+					else if (c == '=') {
+						if (!has_eq) {
+							token.eq = o;
+							has_eq = true;
+						}
+					}
+					else if (c != '\\') {
+						// Whitespace: close the current token, if any.
+						if (o > token.begin) {
+							token.end = o;
+							if (!has_eq) {
+								token.eq = o;
+							}
+							tokens.push_back(token);
+						}
+						token.begin = o + 1;
+						token.quoted = false;
+						has_eq = false;
+					}
+				}
+
+				if (len > token.begin) {
+					token.end = static_cast<uint32_t>(len);
+					if (!has_eq) {
+						token.eq = token.end;
+					}
+					tokens.push_back(token);
+				}
+			}
+
+			/**
+			 * @brief Removes quotes from a token value, resolving escapes in place.
+			 * @in val Value text; escapes follow the emitters' WriteQuoted.
+			 */
+			inline void Unquote(std::string &val) {
+				size_t out = 0;
+				bool in_quote = false;
+				for (size_t i = 0; i < val.size(); i++) {
+					char c = val[i];
+					if (c == '"') {
+						in_quote = !in_quote;
+						continue;
+					}
+					if (in_quote && c == '\\' && i + 1 < val.size()) {
+						c = val[++i];
+						switch (c) {
+						case 'n': c = '\n'; break;
+						case 'r': c = '\r'; break;
+						case 't': c = '\t'; break;
+						case 'u': {
+							// \u00XX (as written for control characters).
+							if (i + 4 < val.size()) {
+								uint32_t code = 0;
+								if (ToHexValue(val.data() + i + 1, 4, code) && code < 0x100) {
+									c = static_cast<char>(code);
+									i += 4;
+								}
+							}
+						} break;
+						default: break;
+						}
+					}
+					val[out++] = c;
+				}
+				val.resize(out);
+			}
+		}
+#pragma endregion
+#pragma region Bytes
+		namespace detail {
+			/**
+			 * @brief Decodes pairs of hexadecimal digits.
+			 * @in src Digits (even count).
+			 * @in len Number of digits.
+			 * @out dst len / 2 bytes.
+			 * @return False if a character is not a hexadecimal digit.
+			 */
+			inline bool DecodeHexScalar(const char *src, size_t len, char *dst) {
+				for (size_t i = 0; i + 1 < len; i += 2) {
+					uint32_t v = 0;
+					if (!ToHexValue(src + i, 2, v)) {
+						return false;
+					}
+					dst[i / 2] = static_cast<char>(v);
+				}
+				return true;
+			}
+
+			/**
+			 * @brief Value of one base64 character (standard or URL-safe alphabet).
+			 * @return 0-63, or -1 if c is not a base64 character.
+			 */
+			inline int Base64Value(unsigned char c) {
+				if (c >= 'A' && c <= 'Z') {
+					return c - 'A';
+				}
+				if (c >= 'a' && c <= 'z') {
+					return c - 'a' + 26;
+				}
+				if (c >= '0' && c <= '9') {
+					return c - '0' + 52;
+				}
+				if (c == '+' || c == '-') {
+					return 62;
+				}
+				if (c == '/' || c == '_') {
+					return 63;
+				}
+				return -1;
+			}
+
+			/**
+			 * @brief Base64 alphabets a value was seen to use (a mix is rejected).
+			 */
+			enum Base64Alphabet {
+				// '+' or '/'.
+				BASE64_STANDARD = 1,
+
+				// '-' or '_'.
+				BASE64_URL_SAFE = 2
+			};
+
+			/**
+			 * @brief Decodes unpadded base64.
+			 * @in src Characters (len % 4 != 1).
+			 * @in len Number of characters.
+			 * @out dst len * 3 / 4 bytes.
+			 * @out alphabets Base64Alphabet bits of the characters seen are added.
+			 * @return False if a character is not in the alphabet or the bits
+			 *   left over after the last byte are not zero.
+			 */
+			inline bool DecodeBase64Scalar(const char *src, size_t len, char *dst, int &alphabets) {
+				uint32_t bits = 0;
+				int count = 0;
+				for (size_t i = 0; i < len; i++) {
+					unsigned char c = static_cast<unsigned char>(src[i]);
+					int v = Base64Value(c);
+					if (v < 0) {
+						return false;
+					}
+					if (v >= 62) {
+						alphabets |= (c == '+' || c == '/') ? BASE64_STANDARD : BASE64_URL_SAFE;
+					}
+					bits = (bits << 6) | static_cast<uint32_t>(v);
+					count += 6;
+					if (count >= 8) {
+						count -= 8;
+						*dst++ = static_cast<char>(bits >> count);
+					}
+				}
+				return (bits & ((1u << count) - 1)) == 0;
+			}
+
+#if AWS_PROTOPARSER_X86
+			/**
+			 * @brief Converts 16 hexadecimal digits to nibbles (SSE2).
+			 * @in p Digits.
+			 * @out bad Bytes not holding a digit are set to all ones.
+			 */
+			inline __m128i HexNibblesSse2(const char *p, __m128i &bad) {
+				__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+
+				// '0'-'9': (c - '0') <= 9 unsigned; letters likewise after folding case.
+				__m128i digit = _mm_sub_epi8(v, _mm_set1_epi8('0'));
+				__m128i is_digit = _mm_cmpeq_epi8(_mm_min_epu8(digit, _mm_set1_epi8(9)), digit);
+				__m128i alpha = _mm_sub_epi8(_mm_or_si128(v, _mm_set1_epi8(0x20)), _mm_set1_epi8('a'));
+				__m128i is_alpha = _mm_cmpeq_epi8(_mm_min_epu8(alpha, _mm_set1_epi8(5)), alpha);
+
+				bad = _mm_or_si128(bad, _mm_andnot_si128(_mm_or_si128(is_digit, is_alpha), _mm_set1_epi8(-1)));
+				return _mm_or_si128(_mm_and_si128(is_digit, digit),
+					_mm_and_si128(is_alpha, _mm_add_epi8(alpha, _mm_set1_epi8(10))));
+			}
+
+			/**
+			 * @brief Joins nibble pairs (high first) into the low byte of each 16-bit lane.
+			 */
+			inline __m128i PackNibblesSse2(__m128i nibbles) {
+				__m128i high = _mm_and_si128(nibbles, _mm_set1_epi16(0x00FF));
+				__m128i low = _mm_srli_epi16(nibbles, 8);
+				return _mm_or_si128(_mm_slli_epi16(high, 4), low);
+			}
+
+			/**
+			 * @brief Converts 32 hexadecimal digits to nibbles (AVX2).
+			 * @in p Digits.
+			 * @out bad Bytes not holding a digit are set to all ones.
+			 */
+			AWS_PROTOPARSER_TARGET_AVX2
+			inline __m256i HexNibblesAvx2(const char *p, __m256i &bad) {
+				__m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+
+				__m256i digit = _mm256_sub_epi8(v, _mm256_set1_epi8('0'));
+				__m256i is_digit = _mm256_cmpeq_epi8(_mm256_min_epu8(digit, _mm256_set1_epi8(9)), digit);
+				__m256i alpha = _mm256_sub_epi8(_mm256_or_si256(v, _mm256_set1_epi8(0x20)), _mm256_set1_epi8('a'));
+				__m256i is_alpha = _mm256_cmpeq_epi8(_mm256_min_epu8(alpha, _mm256_set1_epi8(5)), alpha);
+
+				bad = _mm256_or_si256(bad, _mm256_andnot_si256(_mm256_or_si256(is_digit, is_alpha), _mm256_set1_epi8(-1)));
+				return _mm256_or_si256(_mm256_and_si256(is_digit, digit),
+					_mm256_and_si256(is_alpha, _mm256_add_epi8(alpha, _mm256_set1_epi8(10))));
+			}
+
+			/**
+			 * @brief Joins nibble pairs (high first) into the low byte of each 16-bit lane (AVX2).
+			 */
+			AWS_PROTOPARSER_TARGET_AVX2
+			inline __m256i PackNibblesAvx2(__m256i nibbles) {
+				__m256i high = _mm256_and_si256(nibbles, _mm256_set1_epi16(0x00FF));
+				__m256i low = _mm256_srli_epi16(nibbles, 8);
+				return _mm256_or_si256(_mm256_slli_epi16(high, 4), low);
+			}
+
+			/**
+			 * @brief Decodes hexadecimal digits 32 at a time (SSE2).
+			 */
+			inline bool DecodeHexSse2(const char *src, size_t len, char *dst) {
+				__m128i bad = _mm_setzero_si128();
+				size_t i = 0;
+				for (; i + 32 <= len; i += 32) {
+					__m128i a = PackNibblesSse2(HexNibblesSse2(src + i, bad));
+					__m128i b = PackNibblesSse2(HexNibblesSse2(src + i + 16, bad));
+					_mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i / 2), _mm_packus_epi16(a, b));
+				}
+				if (_mm_movemask_epi8(bad) != 0) {
+					return false;
+				}
+				return DecodeHexScalar(src + i, len - i, dst + i / 2);
+			}
+
+			/**
+			 * @brief Decodes hexadecimal digits 64 at a time (AVX2).
+			 */
+			AWS_PROTOPARSER_TARGET_AVX2
+			inline bool DecodeHexAvx2(const char *src, size_t len, char *dst) {
+				__m256i bad = _mm256_setzero_si256();
+				size_t i = 0;
+				for (; i + 64 <= len; i += 64) {
+					__m256i a = PackNibblesAvx2(HexNibblesAvx2(src + i, bad));
+					__m256i b = PackNibblesAvx2(HexNibblesAvx2(src + i + 32, bad));
+
+					// packus works within 128-bit lanes: put the quarters back in order.
+					__m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), 0xD8);
+					_mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i / 2), packed);
+				}
+				if (_mm256_movemask_epi8(bad) != 0) {
+					return false;
+				}
+				return DecodeHexSse2(src + i, len - i, dst + i / 2);
+			}
+
+			/**
+			 * @brief Decodes 16 base64 characters into 12 bytes (SSE2).
+			 * @out alphabets Base64Alphabet bits of the characters seen are added.
+			 * @return False if a character is not in the alphabet.
+			 */
+			inline bool DecodeBase64BlockSse2(const char *src, char *dst, int &alphabets) {
+				__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src));
+
+				// Signed compares: bytes >= 0x80 fall in no range.
+				__m128i upper = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('A' - 1)),
+					_mm_cmplt_epi8(v, _mm_set1_epi8('Z' + 1)));
+				__m128i lower = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('a' - 1)),
+					_mm_cmplt_epi8(v, _mm_set1_epi8('z' + 1)));
+				__m128i digit = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('0' - 1)),
+					_mm_cmplt_epi8(v, _mm_set1_epi8('9' + 1)));
+				__m128i plus = _mm_cmpeq_epi8(v, _mm_set1_epi8('+'));
+				__m128i minus = _mm_cmpeq_epi8(v, _mm_set1_epi8('-'));
+				__m128i slash = _mm_cmpeq_epi8(v, _mm_set1_epi8('/'));
+				__m128i underscore = _mm_cmpeq_epi8(v, _mm_set1_epi8('_'));
+
+				__m128i valid = _mm_or_si128(_mm_or_si128(upper, lower), _mm_or_si128(digit, plus));
+				valid = _mm_or_si128(valid, _mm_or_si128(_mm_or_si128(minus, slash), underscore));
+				if (_mm_movemask_epi8(valid) != 0xFFFF) {
+					return false;
+				}
+				if (_mm_movemask_epi8(_mm_or_si128(plus, slash)) != 0) {
+					alphabets |= BASE64_STANDARD;
+				}
+				if (_mm_movemask_epi8(_mm_or_si128(minus, underscore)) != 0) {
+					alphabets |= BASE64_URL_SAFE;
+				}
+
+				// Translate: add the offset of the character's range.
+				__m128i shift = _mm_and_si128(upper, _mm_set1_epi8(-'A'));
+				shift = _mm_or_si128(shift, _mm_and_si128(lower, _mm_set1_epi8(26 - 'a')));
+				shift = _mm_or_si128(shift, _mm_and_si128(digit, _mm_set1_epi8(52 - '0')));
+				shift = _mm_or_si128(shift, _mm_and_si128(plus, _mm_set1_epi8(62 - '+')));
+				shift = _mm_or_si128(shift, _mm_and_si128(minus, _mm_set1_epi8(62 - '-')));
+				shift = _mm_or_si128(shift, _mm_and_si128(slash, _mm_set1_epi8(63 - '/')));
+				shift = _mm_or_si128(shift, _mm_and_si128(underscore, _mm_set1_epi8(63 - '_')));
+				__m128i sextets = _mm_add_epi8(v, shift);
+
+				// Pack each 32-bit lane (s0 lowest) into s0:s1:s2:s3, 24 bits.
+				__m128i mask = _mm_set1_epi32(0x3F);
+				__m128i packed = _mm_or_si128(
+					_mm_or_si128(_mm_slli_epi32(_mm_and_si128(sextets, mask), 18),
+						_mm_slli_epi32(_mm_and_si128(_mm_srli_epi32(sextets, 8), mask), 12)),
+					_mm_or_si128(_mm_slli_epi32(_mm_and_si128(_mm_srli_epi32(sextets, 16), mask), 6),
+						_mm_srli_epi32(sextets, 24)));
+
+				uint32_t words[4];
+				_mm_storeu_si128(reinterpret_cast<__m128i *>(words), packed);
+				for (int i = 0; i < 4; i++) {
+					dst[i * 3] = static_cast<char>(words[i] >> 16);
+					dst[i * 3 + 1] = static_cast<char>(words[i] >> 8);
+					dst[i * 3 + 2] = static_cast<char>(words[i]);
+				}
+				return true;
+			}
+
+			/**
+			 * @brief Decodes 32 base64 characters into 24 bytes (AVX2).
+			 * @out alphabets Base64Alphabet bits of the characters seen are added.
+			 * @return False if a character is not in the alphabet.
+			 */
+			AWS_PROTOPARSER_TARGET_AVX2
+			inline bool DecodeBase64BlockAvx2(const char *src, char *dst, int &alphabets) {
+				__m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src));
+
+				// Signed compares: bytes >= 0x80 fall in no range.
+				__m256i upper = _mm256_and_si256(_mm256_cmpgt_epi8(v, _mm256_set1_epi8('A' - 1)),
+					_mm256_cmpgt_epi8(_mm256_set1_epi8('Z' + 1), v));
+				__m256i lower = _mm256_and_si256(_mm256_cmpgt_epi8(v, _mm256_set1_epi8('a' - 1)),
+					_mm256_cmpgt_epi8(_mm256_set1_epi8('z' + 1), v));
+				__m256i digit = _mm256_and_si256(_mm256_cmpgt_epi8(v, _mm256_set1_epi8('0' - 1)),
+					_mm256_cmpgt_epi8(_mm256_set1_epi8('9' + 1), v));
+				__m256i plus = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('+'));
+				__m256i minus = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('-'));
+				__m256i slash = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('/'));
+				__m256i underscore = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('_'));
+
+				__m256i valid = _mm256_or_si256(_mm256_or_si256(upper, lower), _mm256_or_si256(digit, plus));
+				valid = _mm256_or_si256(valid, _mm256_or_si256(_mm256_or_si256(minus, slash), underscore));
+				if (static_cast<uint32_t>(_mm256_movemask_epi8(valid)) != 0xFFFFFFFFu) {
+					return false;
+				}
+				if (_mm256_movemask_epi8(_mm256_or_si256(plus, slash)) != 0) {
+					alphabets |= BASE64_STANDARD;
+				}
+				if (_mm256_movemask_epi8(_mm256_or_si256(minus, underscore)) != 0) {
+					alphabets |= BASE64_URL_SAFE;
+				}
+
+				__m256i shift = _mm256_and_si256(upper, _mm256_set1_epi8(-'A'));
+				shift = _mm256_or_si256(shift, _mm256_and_si256(lower, _mm256_set1_epi8(26 - 'a')));
+				shift = _mm256_or_si256(shift, _mm256_and_si256(digit, _mm256_set1_epi8(52 - '0')));
+				shift = _mm256_or_si256(shift, _mm256_and_si256(plus, _mm256_set1_epi8(62 - '+')));
+				shift = _mm256_or_si256(shift, _mm256_and_si256(minus, _mm256_set1_epi8(62 - '-')));
+				shift = _mm256_or_si256(shift, _mm256_and_si256(slash, _mm256_set1_epi8(63 - '/')));
+				shift = _mm256_or_si256(shift, _mm256_and_si256(underscore, _mm256_set1_epi8(63 - '_')));
+				__m256i sextets = _mm256_add_epi8(v, shift);
+
+				__m256i mask = _mm256_set1_epi32(0x3F);
+				__m256i packed = _mm256_or_si256(
+					_mm256_or_si256(_mm256_slli_epi32(_mm256_and_si256(sextets, mask), 18),
+						_mm256_slli_epi32(_mm256_and_si256(_mm256_srli_epi32(sextets, 8), mask), 12)),
+					_mm256_or_si256(_mm256_slli_epi32(_mm256_and_si256(_mm256_srli_epi32(sextets, 16), mask), 6),
+						_mm256_srli_epi32(sextets, 24)));
+
+				uint32_t words[8];
+				_mm256_storeu_si256(reinterpret_cast<__m256i *>(words), packed);
+				for (int i = 0; i < 8; i++) {
+					dst[i * 3] = static_cast<char>(words[i] >> 16);
+					dst[i * 3 + 1] = static_cast<char>(words[i] >> 8);
+					dst[i * 3 + 2] = static_cast<char>(words[i]);
+				}
+				return true;
+			}
+#endif
+
+			/**
+			 * @brief Decodes hexadecimal digits.
+			 * @in src Digits (even count).
+			 * @in len Number of digits.
+			 * @out dst len / 2 bytes.
+			 * @return False if a character is not a hexadecimal digit.
+			 *
+			 * Uses AVX2 or SSE2 like ScanStructural.
+			 */
+			inline bool DecodeHex(const char *src, size_t len, char *dst) {
+#if AWS_PROTOPARSER_X86
+				static const bool use_avx2 = CpuHasAvx2();
+				if (use_avx2) {
+					return DecodeHexAvx2(src, len, dst);
+				}
+				return DecodeHexSse2(src, len, dst);
+#else
+				return DecodeHexScalar(src, len, dst);
+#endif
+			}
+
+			/**
+			 * @brief Decodes unpadded base64.
+			 * @in src Characters (len % 4 != 1).
+			 * @in len Number of characters.
+			 * @out dst len * 3 / 4 bytes.
+			 * @return False if a character is not in the alphabet, the value
+			 *   mixes the standard and URL-safe alphabets, or the bits left
+			 *   over after the last byte are not zero.
+			 *
+			 * Uses AVX2 or SSE2 like ScanStructural; a partial final quantum (and
+			 * so any trailing bits) always falls to the byte loop.
+			 */
+			inline bool DecodeBase64(const char *src, size_t len, char *dst) {
+				size_t i = 0;
+				int alphabets = 0;
+#if AWS_PROTOPARSER_X86
+				static const bool use_avx2 = CpuHasAvx2();
+				if (use_avx2) {
+					for (; i + 32 <= len; i += 32) {
+						if (!DecodeBase64BlockAvx2(src + i, dst, alphabets)) {
+							return false;
+						}
+						dst += 24;
+					}
+				}
+				for (; i + 16 <= len; i += 16) {
+					if (!DecodeBase64BlockSse2(src + i, dst, alphabets)) {
+						return false;
+					}
+					dst += 12;
+				}
+#endif
+				return DecodeBase64Scalar(src + i, len - i, dst, alphabets) &&
+					alphabets != (BASE64_STANDARD | BASE64_URL_SAFE);
+			}
+
+			/**
+			 * @brief Checks if a bytes value is given encoded ('hex:' or 'base64:').
+			 */
+			inline bool HasBytesPrefix(const std::string &val) {
+				return val.compare(0, 4, "hex:") == 0 || val.compare(0, 7, "base64:") == 0;
+			}
+
+			/**
+			 * @brief Decodes a 'hex:' or 'base64:' value onto the end of a string.
+			 * @in val Value text, including the prefix.
+			 * @in len Length of val.
+			 * @out out Decoded bytes are appended (out is grown once).
+			 * @return False (out unchanged) if the prefix is missing or the
+			 *   value is malformed.
+			 *
+			 * base64 may use the standard or URL-safe alphabet (not both), with
+			 * or without '=' padding; padding may only end the value and must
+			 * fill out its last quantum, and unused trailing bits must be zero.
+			 */
+			inline bool AppendDecodedBytes(const char *val, size_t len, std::string &out) {
+				size_t base = out.size();
+				bool ok = false;
+
+				if (len >= 4 && memcmp(val, "hex:", 4) == 0) {
+					const char *src = val + 4;
+					size_t n = len - 4;
+					if (n % 2 != 0) {
+						return false;
+					}
+					out.resize(base + n / 2);
+					ok = DecodeHex(src, n, &out[0] + base);
+				}
+				else if (len >= 7 && memcmp(val, "base64:", 7) == 0) {
+					const char *src = val + 7;
+					size_t n = len - 7;
+					size_t pad = 0;
+					for (; pad < 2 && n > 0 && src[n - 1] == '='; pad++) {
+						n--;
+					}
+
+					// Padding, when given, must complete the final quantum exactly.
+					if (n % 4 == 1 || (pad != 0 && (n + pad) % 4 != 0)) {
+						return false;
+					}
+					out.resize(base + n / 4 * 3 + (n % 4 == 0 ? 0 : n % 4 - 1));
+					ok = DecodeBase64(src, n, &out[0] + base);
+				}
+				else {
+					return false;
+				}
+
+				if (!ok) {
+					out.resize(base);
+				}
+				return ok;
+			}
+		}
+#pragma endregion
+#pragma region ParserContext
+		namespace detail {
+			/**
+			 * @brief An argument matched to a field, waiting to be applied.
+			 */
+			struct PendingArgument {
+				const FieldPlanEntry *entry;
+				const char *value;
+				size_t len;
+
+				// Value still contains quotes/escapes (see Unquote).
+				bool quoted;
+			};
+
+			/**
+			 * @brief Parse scratch for one nesting depth.
+			 */
+			struct ParseLevel {
+				// Copy of the nested message value the pending arguments point into.
+				std::string text;
+				std::vector<PendingArgument> pending;
+
+				// Per oneof, set once a member has been applied (see ApplyLevel).
+				std::vector<char> oneof_done;
+			};
+		}
+
+		/**
+		 * @brief A piece of parsed input, referenced in place (not copied).
+		 */
+		struct ArgumentSlice {
+			const char *data;
+			size_t len;
+		};
+
+		/**
+		 * @brief Reusable state for repeated parsing.
+		 *
+		 * Owns the scratch strings and per-depth argument lists used by Parse
+		 * and GetAsString, plus a pool of messages recycled with Clear().  Once
+		 * warm, parsing into pooled messages does not touch the heap, other
+		 * than string values too long for the small-string buffer being copied
+		 * into the message, and string oneof members (which Clear() frees).
+		 * Not thread-safe; keep one per thread.
+		 */
+		class ParserContext {
+		public:
+			ParserContext() {
+			}
+
+			~ParserContext() {
+				for (size_t i = 0; i < pool_.size(); i++) {
+					delete pool_[i];
+				}
+			}
+
+			/**
+			 * @brief Gets a cleared message of the prototype's type.
+			 * @in prototype Any message of the wanted type.
+			 * @return A pooled (cleared) message, or a new one if none are free.
+			 *
+			 * The caller owns the message until it is handed back with Release.
+			 */
+			MESSAGE *Acquire(const MESSAGE &prototype) {
+				const DESCRIPTOR *desc = prototype.GetDescriptor();
+				for (size_t i = pool_.size(); i-- > 0;) {
+					if (pool_[i]->GetDescriptor() == desc) {
+						MESSAGE *msg = pool_[i];
+						pool_[i] = pool_.back();
+						pool_.pop_back();
+						msg->Clear();
+						return msg;
+					}
+				}
+				return prototype.New();
+			}
+
+			/**
+			 * @brief Returns a message to the pool (the context then owns it).
+			 */
+			void Release(MESSAGE *msg) {
+				if (msg != nullptr) {
+					pool_.push_back(msg);
+				}
+			}
+
+			// Scratch used by Parse and GetAsString; contents are transient.
+			std::string key;
+			std::string val;
+			std::string text;
+
+			// Matched arguments, one list per nesting depth (0 is the top level).
+			std::deque<detail::ParseLevel> levels;
+
+			// Structural offsets and tokens of the buffer being split.
+			std::vector<uint32_t> structural;
+			std::vector<detail::Token> tokens;
+
+			// Top-level arguments (or tokens) of the last parse that matched no
+			// field, in order and exactly as given (a leading '--' is kept on
+			// every path).  They point into the parsed input.
+			std::vector<ArgumentSlice> unknown;
+
+		private:
+			ParserContext(const ParserContext &);
+			ParserContext &operator=(const ParserContext &);
+
+			std::vector<MESSAGE *> pool_;
+		};
+#pragma endregion
+
+		/**
+		 * @brief Writes the value of a field as GetAsString formats it.
+		 * @in writer Destination.
+		 * @in msg Google Protocol Buffer Message.
+		 * @in field_name Name of the field in question.
+		 * @in indent Number of tabs before it (only applies to messages).
+		 * @return True if the field was found.
+		 */
+		inline bool WriteAsString(Writer &writer, const MESSAGE &msg,
+			const std::string &field_name, int indent = 0) {
+
+			const detail::FieldPlanEntry *entry =
+				detail::GetFieldPlan(msg.GetDescriptor())->Find(field_name);
+			if (entry == nullptr) {
+				return false;
+			}
+
+			if (entry->type == FIELDDESC::TYPE_MESSAGE) {
+				HumanEmitter emitter(writer, indent + 1);
+				Emit(msg.GetReflection()->GetMessage(msg, entry->field), emitter);
+			}
+			else {
+				std::string scratch;
+				detail::WriteValue(writer, msg, *entry, false, &scratch);
+			}
+			return true;
+		}
+
+		/**
+		 * @brief Gets the value of a field as a string.
+		 * @in msg Google Protocol Buffer Message.
+		 * @in field_name Name of the field in question.
+		 * @in indent Number of tabs before it (only applies to messages).
+		 * @return Value of the field (or inline message) as string.
+		 */
+		inline std::string GetAsString(MESSAGE *msg, std::string field_name,
+			int indent = 0) {
+
+			std::string out = "";
+			{
+				Writer writer(&out);
+				WriteAsString(writer, *msg, field_name, indent);
+			}
+			return out;
+		}
+
+		/**
+		 * @brief Gets the value of a field as a string, reusing the context's buffer.
+		 * @in ctx Parser context (owns the returned string).
+		 * @in msg Google Protocol Buffer Message.
+		 * @in field_name Name of the field in question.
+		 * @in indent Number of tabs before it (only applies to messages).
+		 * @return Value of the field; valid until the context is next used.
+		 */
+		inline const std::string &GetAsString(ParserContext &ctx, const MESSAGE &msg,
+			const std::string &field_name, int indent = 0) {
+
+			ctx.text.clear();
+			{
+				Writer writer(&ctx.text);
+				WriteAsString(writer, msg, field_name, indent);
+			}
+			return ctx.text;
+		}
+
+		namespace detail {
+			/**
+			 * @brief Gets the (cleared) scratch for a nesting depth.
+			 *
+			 * Level 0 starts a new parse, which also clears ctx.unknown.
+			 */
+			inline ParseLevel &BeginLevel(ParserContext &ctx, size_t level) {
+				if (ctx.levels.size() <= level) {
+					ctx.levels.resize(level + 1);
+				}
+				if (level == 0) {
+					ctx.unknown.clear();
+				}
+				ParseLevel &lv = ctx.levels[level];
+				lv.pending.clear();
+				return lv;
+			}
+
+			/**
+			 * @brief Matches a key to a field and queues its value for ApplyPending.
+			 * @in ctx Parser context.
+			 * @in plan Field plan of the message being filled.
+			 * @in level Nesting depth (index into ctx.levels).
+			 * @in key Key text.
+			 * @in key_len Length of key.
+			 * @in value Value text (must stay valid until the level is applied).
+			 * @in value_len Length of value.
+			 * @in quoted True if the value still needs Unquote.
+			 * @in force_lowercase If true the field will be searched for in lowercase.
+			 * @return True if the key matched a field.
+			 */
+			inline bool ResolveKeyValue(ParserContext &ctx, const FieldPlan *plan,
+				size_t level, const char *key, size_t key_len,
+				const char *value, size_t value_len, bool quoted, bool force_lowercase) {
+
+				ctx.key.assign(key, key_len);
+				if (force_lowercase) {
+					std::transform(ctx.key.begin(), ctx.key.end(), ctx.key.begin(), ::tolower);
+				}
+
+				const FieldPlanEntry *entry = plan->Find(ctx.key, force_lowercase);
+				if (entry == nullptr) {
+					return false;
+				}
+
+				// A message value given as one quoted string (as ArgvEmitter
+				// writes it) is unquoted as it would be in a buffer.
+				if (!quoted && entry->type == FIELDDESC::TYPE_MESSAGE && value_len > 0 && value[0] == '"') {
+					quoted = true;
+				}
+
+				PendingArgument pending = { entry, value, value_len, quoted };
+				ctx.levels[level].pending.push_back(pending);
+				return true;
+			}
+
+			/**
+			 * @brief Matches one 'key=value' argument (without the leading '--')
+			 *   to a field and queues it for ApplyPending.
+			 * @in ctx Parser context.
+			 * @in plan Field plan of the message being filled.
+			 * @in level Nesting depth (index into ctx.levels).
+			 * @in arg Argument text (need not be NUL terminated; must stay valid
+			 *   until the level is applied).
+			 * @in len Length of arg.
+			 * @in force_lowercase If true the field will be searched for in lowercase.
+			 * @return True if the argument matched a field.
+			 */
+			inline bool ResolveArgument(ParserContext &ctx, const FieldPlan *plan,
+				size_t level, const char *arg, size_t len, bool force_lowercase) {
+
+				const char *eq = static_cast<const char *>(memchr(arg, '=', len));
+				if (eq == nullptr || eq == arg) {
+					return false;
+				}
+
+				return ResolveKeyValue(ctx, plan, level, arg, static_cast<size_t>(eq - arg),
+					eq + 1, static_cast<size_t>(arg + len - (eq + 1)), false, force_lowercase);
+			}
+
+			/**
+			 * @brief Splits a buffer into 'key=value' tokens and queues them.
+			 * @in ctx Parser context.
+			 * @in plan Field plan of the message being filled.
+			 * @in level Nesting depth (index into ctx.levels).
+			 * @in data Buffer (must stay valid until the level is applied).
+			 * @in len Length of the buffer.
+			 * @in force_lowercase If true the field will be searched for in lowercase.
+			 *
+			 * Tokens are separated by whitespace; a leading '--' on a key is
+			 * dropped and quoted values may contain whitespace.  At level 0,
+			 * tokens matching no field are recorded in ctx.unknown.
+			 */
+			inline void ResolveBuffer(ParserContext &ctx, const FieldPlan *plan,
+				size_t level, const char *data, size_t len, bool force_lowercase) {
+
+				ScanStructural(data, len, ctx.structural);
+				TokenizeStructural(data, len, ctx.structural, ctx.tokens);
+
+				for (size_t i = 0; i < ctx.tokens.size(); i++) {
+					const Token &token = ctx.tokens[i];
+					uint32_t key_begin = token.begin;
+					if (token.eq - key_begin >= 2 && data[key_begin] == '-' && data[key_begin + 1] == '-') {
+						key_begin += 2;
+					}
+					bool matched = token.eq != token.end && token.eq != key_begin &&
+						ResolveKeyValue(ctx, plan, level, data + key_begin, token.eq - key_begin,
+							data + token.eq + 1, token.end - token.eq - 1, token.quoted, force_lowercase);
+					if (!matched && level == 0) {
+						ArgumentSlice slice = { data + token.begin, token.end - token.begin };
+						ctx.unknown.push_back(slice);
+					}
+				}
+			}
+
+			/**
+			 * @brief Matches argc/argv ('--key=value' arguments) at level 0.
+			 * @in ctx Parser context (level 0 begun).
+			 * @in plan Field plan of the message being filled.
+			 * @in argc 'argc' from the main function/entry point.
+			 * @in argv 'argv' from the main function/entry point.
+			 * @in force_lowercase If true the field will be searched for in lowercase.
+			 *
+			 * Every other argument (including ones without '--') is recorded in
+			 * ctx.unknown; those slices are the NUL terminated argv strings.
+			 */
+			inline void ResolveArgv(ParserContext &ctx, const FieldPlan *plan,
+				int argc, char **argv, bool force_lowercase) {
+				for (int i = 1; i < argc; i++) {
+					const char *arg = argv[i];
+					size_t len = strlen(arg);
+					if (len < 2 || arg[0] != '-' || arg[1] != '-' ||
+						!ResolveArgument(ctx, plan, 0, arg + 2, len - 2, force_lowercase)) {
+						ArgumentSlice slice = { arg, len };
+						ctx.unknown.push_back(slice);
+					}
+				}
+			}
+
+			inline void ApplyPending(ParserContext &ctx, MESSAGE *msg,
+				const FieldPlan *plan, size_t level, bool force_lowercase);
+
+			/**
+			 * @brief Finds the enum value named (or numbered) by a value.
+			 * @in entry Field (must be TYPE_ENUM).
+			 * @in val Value text; tried as given, lowercase, uppercase and
+			 *   as a number (val is left case-converted).
+			 * @return Value descriptor, or nullptr if nothing matched.
+			 */
+			inline const ENUMVALUEDESC *FindEnumValue(const FieldPlanEntry &entry, std::string &val) {
+
+				// The enum may be declared anywhere; use the field's own type.
+				const ENUMDESC *enum_desc = entry.enum_meta->desc;
+				const ENUMVALUEDESC *enum_value_desc = nullptr;
+
+				// try incoming
+				enum_value_desc = enum_desc->FindValueByName(val);
+				if (enum_value_desc == nullptr) {
+					// try lower
+					std::transform(val.begin(), val.end(), val.begin(), ::tolower);
+					enum_value_desc = enum_desc->FindValueByName(val);
+					if (enum_value_desc == nullptr) {
+						// try upper 
+						std::transform(val.begin(), val.end(), val.begin(), ::toupper);
+						enum_value_desc = enum_desc->FindValueByName(val);
+						if (enum_value_desc == nullptr) {
+							// try number
+							int32_t ival = 0;
+							if (ToInt32(val, ival)) {
+								enum_value_desc = entry.enum_meta->FindValueByNumber(ival);
+							}
+						}
+					}
+				}
+				return enum_value_desc;
+			}
+
+			/**
+			 * @brief Applies the pending arguments of a depth in argument order.
+			 * @in lv Parse level whose pending list is complete.
+			 * @in plan Field plan the pending entries belong to.
+			 * @in apply Called with an index into lv.pending; returns false if the
+			 *   value did not convert (and nothing was stored).
+			 *
+			 * Within a oneof the last member given with a value that converts wins
+			 * and the members before it are never set; a message member merges all
+			 * of its values, in order.
+			 */
+			template <typename Apply>
+			inline void ApplyLevel(ParseLevel &lv, const FieldPlan *plan, Apply apply) {
+				bool has_oneof = false;
+				for (size_t i = 0; i < lv.pending.size(); i++) {
+					if (lv.pending[i].entry->oneof_index >= 0) {
+						has_oneof = true;
+						continue;
+					}
+					apply(i);
+				}
+				if (!has_oneof) {
+					return;
+				}
+
+				// Walk back from the last member; the first that converts wins.
+				lv.oneof_done.assign(static_cast<size_t>(plan->oneof_count), 0);
+				for (size_t i = lv.pending.size(); i-- > 0;) {
+					const FieldPlanEntry *entry = lv.pending[i].entry;
+					if (entry->oneof_index < 0 || lv.oneof_done[static_cast<size_t>(entry->oneof_index)]) {
+						continue;
+					}
+					if (entry->type == FIELDDESC::TYPE_MESSAGE) {
+						for (size_t j = 0; j <= i; j++) {
+							if (lv.pending[j].entry == entry) {
+								apply(j);
+							}
+						}
+						lv.oneof_done[static_cast<size_t>(entry->oneof_index)] = 1;
+					}
+					else if (apply(i)) {
+						lv.oneof_done[static_cast<size_t>(entry->oneof_index)] = 1;
+					}
+				}
+			}
+
+			/**
+			 * @brief Checks for +0.0 (the proto3 default; -0.0 is a set value).
+			 */
+			inline bool IsPositiveZero(double value) {
+				uint64_t bits = 0;
+				memcpy(&bits, &value, sizeof(bits));
+				return bits == 0;
+			}
+
+			/**
+			 * @brief Checks if storing a value can be skipped.
+			 * @in msg Message being filled.
+			 * @in entry Field.
+			 * @in is_default True if the value is the type's default (0, "", false).
+			 * @return True for an implicit-presence field still at its default,
+			 *   where the reflective set would change nothing.
+			 */
+			inline bool CanSkipDefault(const MESSAGE &msg, const FieldPlanEntry &entry, bool is_default) {
+				return is_default && entry.implicit_presence &&
+					!msg.GetReflection()->HasField(msg, entry.field);
+			}
+
+			/**
+			 * @brief Converts and stores one value (ctx.val) into a field.
+			 * @in ctx Parser context; ctx.val holds the value and may be modified.
+			 * @in msg Message being filled.
+			 * @in entry Field to set.
+			 * @in level Nesting depth of msg.
+			 * @in force_lowercase Passed on to nested messages.
+			 * @return false if the value did not convert (msg is unchanged).
+			 */
+			inline bool ApplyValue(ParserContext &ctx, MESSAGE *msg,
+				const FieldPlanEntry &entry, size_t level, bool force_lowercase) {
+
+				const REFLECTION *refl = msg->GetReflection();
+				const FIELDDESC *field_descriptor = entry.field;
+				std::string &val = ctx.val;
+
+				switch (entry.type) {
+				case FIELDDESC::TYPE_BOOL: {
+					std::transform(val.begin(), val.end(), val.begin(), ::tolower);
+					bool bval = val == "true" || val == "1";
+					if (!CanSkipDefault(*msg, entry, !bval)) {
+						refl->SetBool(msg, field_descriptor, bval);
+					}
+					return true;
+				}
+
+				case FIELDDESC::TYPE_BYTES: {
+					if (HasBytesPrefix(val)) {
+						// Decode into a buffer sized once, which the message then takes.
+						std::string bytes;
+						if (!AppendDecodedBytes(val.data(), val.size(), bytes)) {
+							return false;
+						}
+						if (!CanSkipDefault(*msg, entry, bytes.empty())) {
+							refl->SetString(msg, field_descriptor, std::move(bytes));
+						}
+						return true;
+					}
+					if (!CanSkipDefault(*msg, entry, val.empty())) {
+						refl->SetString(msg, field_descriptor, val);
+					}
+					return true;
+				}
+
+				case FIELDDESC::TYPE_STRING: {
+					if (!CanSkipDefault(*msg, entry, val.empty())) {
+						refl->SetString(msg, field_descriptor, val);
+					}
+					return true;
+				}
+
+				case FIELDDESC::TYPE_DOUBLE: {
+					double dval = 0.0;
+					if (!ToDouble(val, dval)) {
+						return false;
+					}
+					if (!CanSkipDefault(*msg, entry, IsPositiveZero(dval))) {
+						refl->SetDouble(msg, field_descriptor, dval);
+					}
+					return true;
+				}
+
+				case FIELDDESC::TYPE_ENUM: {
+					const ENUMVALUEDESC *enum_value_desc = FindEnumValue(entry, val);
+
+					// If we have a value, update enum_value
+					if (enum_value_desc != nullptr) {
+						if (!CanSkipDefault(*msg, entry, enum_value_desc->number() == 0)) {
+							refl->SetEnum(msg, field_descriptor, enum_value_desc);
+						}
+						return true;
+					}
+					if (entry.enum_meta->open) {
+						// Open enums keep numbers they do not declare.
+						int32_t ival = 0;
+						if (ToInt32(val, ival)) {
+							refl->SetEnumValue(msg, field_descriptor, ival);
+							return true;
+						}
+					}
+					return false;
+				}
+
+				case FIELDDESC::TYPE_FIXED32:
+				case FIELDDESC::TYPE_UINT32: {
+					uint32_t uval = 0;
+					if (!ToUInt32(val, uval)) {
+						return false;
+					}
+					if (!CanSkipDefault(*msg, entry, uval == 0)) {
+						refl->SetUInt32(msg, field_descriptor, uval);
+					}
+					return true;
+				}
+
+				case FIELDDESC::TYPE_FIXED64:
+				case FIELDDESC::TYPE_UINT64: {
+					uint64_t uval = 0;
+					if (!ToUInt64(val, uval)) {
+						return false;
+					}
+					if (!CanSkipDefault(*msg, entry, uval == 0)) {
+						refl->SetUInt64(msg, field_descriptor, uval);
+					}
+					return true;
+				}
+
+				case FIELDDESC::TYPE_FLOAT: {
+					float fval = 0.0f;
+					if (!ToFloat(val, fval)) {
+						return false;
+					}
+					if (!CanSkipDefault(*msg, entry, IsPositiveZero(fval))) {
+						refl->SetFloat(msg, field_descriptor, fval);
+					}
+					return true;
+				}
+
+				case FIELDDESC::TYPE_GROUP: {
+					// todo ?
+					// - Probably shouldn't be used anyway.
+					return false;
+				}
+
+				case FIELDDESC::TYPE_MESSAGE: {
+					// Experimental and unrecommended.
+
+					// Get the internal message from the field descriptor.
+					MESSAGE *internal_message = refl->MutableMessage(msg, field_descriptor);
+					const FieldPlan *internal_plan = GetFieldPlan(internal_message->GetDescriptor());
+
+					// Keep a copy of the value; the arguments below point into it.
+					ParseLevel &lv = BeginLevel(ctx, level + 1);
+					lv.text.assign(val);
+
+					// Split into tokens (quotes group whitespace) and match them.
+					ResolveBuffer(ctx, internal_plan, level + 1,
+						lv.text.data(), lv.text.size(), force_lowercase);
+
+					// Now process it ...
+					ApplyPending(ctx, internal_message, internal_plan, level + 1, force_lowercase);
+					return true;
+				}
+
+				case FIELDDESC::TYPE_SFIXED32:
+				case FIELDDESC::TYPE_SINT32:
+				case FIELDDESC::TYPE_INT32: {
+					int32_t ival = 0;
+					if (!ToInt32(val, ival)) {
+						return false;
+					}
+					if (!CanSkipDefault(*msg, entry, ival == 0)) {
+						refl->SetInt32(msg, field_descriptor, ival);
+					}
+					return true;
+				}
+
+				case FIELDDESC::TYPE_SFIXED64:
+				case FIELDDESC::TYPE_SINT64:
+				case FIELDDESC::TYPE_INT64: {
+					int64_t ival = 0;
+					if (!ToInt64(val, ival)) {
+						return false;
+					}
+					if (!CanSkipDefault(*msg, entry, ival == 0)) {
+						refl->SetInt64(msg, field_descriptor, ival);
+					}
+					return true;
+				}
+
+					// Problem or out of date support.
+				default: return false;
+				}
+			}
+
+			/**
+			 * @brief Applies the arguments queued at a nesting depth, in order.
+			 * @in ctx Parser context.
+			 * @in msg Message being filled.
+			 * @in plan Field plan of msg.
+			 * @in level Nesting depth (index into ctx.levels).
+			 * @in force_lowercase Passed on to nested messages.
+			 *
+			 * When several members of one oneof are given only the winner (see
+			 * ApplyLevel) is applied, rather than setting (and clearing) each
+			 * in turn.
+			 */
+			inline void ApplyPending(ParserContext &ctx, MESSAGE *msg,
+				const FieldPlan *plan, size_t level, bool force_lowercase) {
+
+				ParseLevel &lv = ctx.levels[level];
+				ApplyLevel(lv, plan, [&](size_t i) {
+					const PendingArgument &pending = lv.pending[i];
+					ctx.val.assign(pending.value, pending.len);
+					if (pending.quoted) {
+						Unquote(ctx.val);
+					}
+					return ApplyValue(ctx, msg, *pending.entry, level, force_lowercase);
+				});
+			}
+		}
+
+		/**
+		 * @brief Processes the vectored argc/argv into a message (where fields match).
+		 * @in ctx Parser context to reuse between calls.
+		 * @in vec vector of argc/argv ('key=value' entries; a leading '--' is
+		 *   accepted, so argv can be copied in as is).
+		 * @in msg A Google Protocol Buffers message.
+		 * @in force_lowercase If true the field will be searched for in lowercase.
+		 *
+		 * Entries matching no field are left in ctx.unknown as given.
+		 */
+		inline void Parse(ParserContext &ctx, const std::vector<std::string> &vec,
+			MESSAGE *msg, bool force_lowercase = false) {
+
+			// If it is NOT a Protocol Buffer message we are wasting our time
+			// and heading towards a segfault.
+			if (msg == nullptr) {
+				return;
+			}
+
+			const detail::FieldPlan *plan = detail::GetFieldPlan(msg->GetDescriptor());
+			detail::BeginLevel(ctx, 0);
+			for (size_t i = 0; i < vec.size(); i++) {
+				const char *arg = vec[i].data();
+				size_t skip = vec[i].size() >= 2 && arg[0] == '-' && arg[1] == '-' ? 2 : 0;
+				if (!detail::ResolveArgument(ctx, plan, 0, arg + skip, vec[i].size() - skip, force_lowercase)) {
+					ArgumentSlice slice = { vec[i].c_str(), vec[i].size() };
+					ctx.unknown.push_back(slice);
+				}
+			}
+			detail::ApplyPending(ctx, msg, plan, 0, force_lowercase);
+		}
+
+		/**
+		 * @brief Processes argc/argv into a message (where fields match).
+		 * @in ctx Parser context to reuse between calls.
+		 * @in argc 'argc' from the main function/entry point.
+		 * @in argv 'argv' from the main function/entry point.
+		 * @in msg A Google Protocol Buffer message.
+		 * @in force_lowercase If true the field will be searched for in lowercase.
+		 *
+		 * Arguments are read in place; no intermediate vector is built.  The
+		 * arguments matching no field are left in ctx.unknown (see
+		 * StoreUnknownArguments to keep them in the message).
+		 */
+		inline void Parse(ParserContext &ctx, int argc, char **argv,
+			MESSAGE *msg, bool force_lowercase = false) {
+
+			// If it is NOT a Protocol Buffer message we are wasting our time
+			// and heading towards a segfault.
+			if (msg == nullptr) {
+				return;
+			}
+
+			const detail::FieldPlan *plan = detail::GetFieldPlan(msg->GetDescriptor());
+			detail::BeginLevel(ctx, 0);
+			detail::ResolveArgv(ctx, plan, argc, argv, force_lowercase);
+			detail::ApplyPending(ctx, msg, plan, 0, force_lowercase);
+		}
+
+		/**
+		 * @brief Processes a buffer of whitespace separated 'key=value' pairs.
+		 * @in ctx Parser context to reuse between calls.
+		 * @in data Buffer (e.g. a config file or record); need not be NUL terminated.
+		 * @in len Length of the buffer (less than 4GiB).
+		 * @in msg A Google Protocol Buffer message.
+		 * @in force_lowercase If true the field will be searched for in lowercase.
+		 *
+		 * Keys may carry a leading '--'.  Values may be double quoted to hold
+		 * whitespace, with backslash escapes inside the quotes.  Tokens
+		 * matching no field are left in ctx.unknown.
+		 */
+		inline void ParseBuffer(ParserContext &ctx, const char *data, size_t len,
+			MESSAGE *msg, bool force_lowercase = false) {
+
+			if (msg == nullptr || data == nullptr || len > UINT32_MAX) {
+				return;
+			}
+
+			const detail::FieldPlan *plan = detail::GetFieldPlan(msg->GetDescriptor());
+			detail::BeginLevel(ctx, 0);
+			detail::ResolveBuffer(ctx, plan, 0, data, len, force_lowercase);
+			detail::ApplyPending(ctx, msg, plan, 0, force_lowercase);
+		}
+
+		/**
+		 * @brief Processes a buffer of whitespace separated 'key=value' pairs.
+		 * @in data Buffer; need not be NUL terminated.
+		 * @in len Length of the buffer.
+		 * @in msg A Google Protocol Buffer message.
+		 * @in force_lowercase If true the field will be searched for in lowercase.
+		 */
+		inline void ParseBuffer(const char *data, size_t len,
+			MESSAGE *msg, bool force_lowercase = false) {
+			ParserContext ctx;
+			ParseBuffer(ctx, data, len, msg, force_lowercase);
+		}
 
 		/**
 		 * @brief Processes the vectored argc/argv into a message (where fields match).
@@ -710,228 +3596,1381 @@ namespace aws {
 		 */
 		inline void Parse(std::vector<std::string> &vec,
 			MESSAGE* msg, bool force_lowercase = false) {
+			ParserContext ctx;
+			Parse(ctx, vec, msg, force_lowercase);
+		}
+
+		/**
+		 * @brief Processes argc/argv into a message (where fields match).
+		 * @in argc 'argc' from the main function/entry point.
+		 * @in argv 'argv' from the main function/entry point.
+		 * @in msg A Google Protocol Buffer message.
+		 * @in force_lowercase If true the field will be searched for in lowercase.
+		 *
+		 * Extensions are matched as '--Name=' or '--[full.name]='.  Only those
+		 * in the message's pool the first time its type is parsed, dumped or
+		 * read here are known (see detail::FieldPlan): register extensions,
+		 * or build their files into a dynamic pool, before that.
+		 */
+		inline void Parse(int argc, char **argv,
+			MESSAGE *msg, bool force_lowercase = false) {
+			ParserContext ctx;
+			Parse(ctx, argc, argv, msg, force_lowercase);
+		}
+
+		/**
+		 * @brief Processes argc/argv, keeping the arguments no field matched.
+		 * @in argc 'argc' from the main function/entry point.
+		 * @in argv 'argv' from the main function/entry point.
+		 * @in msg A Google Protocol Buffer message.
+		 * @out unknown Replaced with the unmatched arguments (argv[0] excluded),
+		 *   in order; each points at the argv string itself.
+		 * @in force_lowercase If true the field will be searched for in lowercase.
+		 */
+		inline void ParseCollectUnknown(int argc, char **argv, MESSAGE *msg,
+			std::vector<ArgumentSlice> *unknown, bool force_lowercase = false) {
+			ParserContext ctx;
+			Parse(ctx, argc, argv, msg, force_lowercase);
+			if (unknown != nullptr) {
+				unknown->swap(ctx.unknown);
+			}
+		}
+
+		/**
+		 * @brief Keeps the unmatched arguments of the last parse in a message.
+		 * @in ctx Parser context msg was parsed with.
+		 * @in msg Message to hold them.
+		 * @in field_number Number to store them under (one length-delimited
+		 *   unknown field per argument); must not be used by a field of msg.
+		 * @return False if field_number is taken or out of range.
+		 *
+		 * The arguments are serialized with the message, so they pass through
+		 * to whatever reads it, and can be read back from the UnknownFieldSet.
+		 */
+		inline bool StoreUnknownArguments(const ParserContext &ctx, MESSAGE *msg, int field_number) {
+			if (msg == nullptr || field_number < 1 || field_number > FIELDDESC::kMaxNumber ||
+				msg->GetDescriptor()->FindFieldByNumber(field_number) != nullptr ||
+				msg->GetDescriptor()->IsExtensionNumber(field_number)) {
+				return false;
+			}
+
+			::google::protobuf::UnknownFieldSet *fields =
+				msg->GetReflection()->MutableUnknownFields(msg);
+			for (size_t i = 0; i < ctx.unknown.size(); i++) {
+				fields->AddLengthDelimited(field_number,
+					std::string(ctx.unknown[i].data, ctx.unknown[i].len));
+			}
+			return true;
+		}
+
+#pragma region LazyConfig
+		/**
+		 * @brief Deferred view of argc/argv or a buffer.
+		 *
+		 * Index() only records where the values of each field are; nothing is
+		 * converted.  The typed getters below convert a field on first use
+		 * (every value given for it, as Parse would) and keep the result, and
+		 * Materialize() applies all values to a real message exactly as Parse
+		 * does.
+		 *
+		 * The indexed argv/buffer must outlive the view.  Not thread-safe (the
+		 * getters memoize).
+		 */
+		class LazyConfig {
+		public:
+			/**
+			 * @in prototype Any message of the type being configured.
+			 */
+			explicit LazyConfig(const MESSAGE &prototype)
+				: plan_(detail::GetFieldPlan(prototype.GetDescriptor())),
+				scratch_(prototype.New()),
+				states_(plan_->fields.size()),
+				force_lowercase_(false) {
+			}
+
+			~LazyConfig() {
+				delete scratch_;
+			}
+
+			/**
+			 * @brief Indexes argc/argv ('--key=value' arguments, as Parse).
+			 * @in argc 'argc' from the main function/entry point.
+			 * @in argv 'argv' from the main function/entry point.
+			 * @in force_lowercase If true the field will be searched for in lowercase.
+			 */
+			void Index(int argc, char **argv, bool force_lowercase = false) {
+				Reset(force_lowercase);
+				detail::ResolveArgv(ctx_, plan_, argc, argv, force_lowercase);
+				Record();
+			}
+
+			/**
+			 * @brief Indexes a buffer of 'key=value' pairs (as ParseBuffer).
+			 * @in data Buffer; need not be NUL terminated.
+			 * @in len Length of the buffer (less than 4GiB).
+			 * @in force_lowercase If true the field will be searched for in lowercase.
+			 */
+			void Index(const char *data, size_t len, bool force_lowercase = false) {
+				Reset(force_lowercase);
+				if (data != nullptr && len <= UINT32_MAX) {
+					detail::ResolveBuffer(ctx_, plan_, 0, data, len, force_lowercase);
+				}
+				Record();
+			}
+
+			/**
+			 * @brief Arguments (or tokens) of the last Index() that matched no field.
+			 */
+			const std::vector<ArgumentSlice> &Unknown() const {
+				return ctx_.unknown;
+			}
+
+			/**
+			 * @brief Checks if a value was given for a field.
+			 */
+			bool Has(const std::string &field_name) const {
+				const detail::FieldPlanEntry *entry = plan_->Find(field_name);
+				return entry != nullptr && states_[Slot(entry)].given;
+			}
+
+			/**
+			 * @brief Converts a field (once) and returns the message holding it.
+			 * @in field_name Name of the field.
+			 * @return Internal message holding the field's value, or nullptr if
+			 *   no valid value was given (or a later oneof member won).
+			 */
+			MESSAGE *Fetch(const std::string &field_name) {
+				const detail::FieldPlanEntry *entry = plan_->Find(field_name);
+				if (entry == nullptr || !Convert(*entry)) {
+					return nullptr;
+				}
+				return scratch_;
+			}
+
+			/**
+			 * @brief Converts every indexed value into a message, as Parse would.
+			 * @in msg Message of the prototype's type.
+			 * @return False if msg is of a different type.
+			 */
+			bool Materialize(MESSAGE *msg) {
+				if (msg == nullptr || msg->GetDescriptor() != plan_->desc) {
+					return false;
+				}
+				detail::ApplyPending(ctx_, msg, plan_, 0, force_lowercase_);
+				return true;
+			}
+
+		private:
+			struct FieldState {
+				// A value was given for the field.
+				bool given;
+
+				// The field's values have been applied to scratch_.
+				bool converted;
+
+				// One of them converted (proto3 may not store a default value).
+				bool valid;
+			};
+
+			size_t Slot(const detail::FieldPlanEntry *entry) const {
+				return static_cast<size_t>(entry - &plan_->fields[0]);
+			}
+
+			void Reset(bool force_lowercase) {
+				force_lowercase_ = force_lowercase;
+				scratch_->Clear();
+				FieldState empty = { false, false, false };
+				std::fill(states_.begin(), states_.end(), empty);
+				detail::BeginLevel(ctx_, 0);
+			}
+
+			// Notes which fields were given; the values stay in the pending list.
+			void Record() {
+				const std::vector<detail::PendingArgument> &pending = ctx_.levels[0].pending;
+				for (size_t i = 0; i < pending.size(); i++) {
+					states_[Slot(pending[i].entry)].given = true;
+				}
+			}
+
+			// Applies every value of a field (for a oneof member, of its whole
+			// oneof) to scratch_, under the same rules as ApplyPending.
+			bool Convert(const detail::FieldPlanEntry &entry) {
+				if (!states_[Slot(&entry)].given) {
+					return false;
+				}
+				if (!states_[Slot(&entry)].converted) {
+					detail::ParseLevel &lv = ctx_.levels[0];
+					detail::ApplyLevel(lv, plan_, [&](size_t i) {
+						const detail::PendingArgument &pending = lv.pending[i];
+						bool wanted = pending.entry == &entry || (entry.oneof_index >= 0 &&
+							pending.entry->oneof_index == entry.oneof_index);
+						if (!wanted) {
+							return true;
+						}
+						ctx_.val.assign(pending.value, pending.len);
+						if (pending.quoted) {
+							detail::Unquote(ctx_.val);
+						}
+						if (!detail::ApplyValue(ctx_, scratch_, *pending.entry, 0, force_lowercase_)) {
+							return false;
+						}
+						states_[Slot(pending.entry)].valid = true;
+						return true;
+					});
+
+					for (size_t j = 0; j < plan_->fields.size(); j++) {
+						if (&plan_->fields[j] == &entry || (entry.oneof_index >= 0 &&
+							plan_->fields[j].oneof_index == entry.oneof_index)) {
+							states_[j].converted = true;
+						}
+					}
+				}
+				// A oneof member may have converted and still lost to a later one.
+				return states_[Slot(&entry)].valid && (entry.oneof_index < 0 ||
+					scratch_->GetReflection()->HasField(*scratch_, entry.field));
+			}
+
+			LazyConfig(const LazyConfig &);
+			LazyConfig &operator=(const LazyConfig &);
+
+			const detail::FieldPlan *plan_;
+			MESSAGE *scratch_;
+			std::vector<FieldState> states_;
+			ParserContext ctx_;
+			bool force_lowercase_;
+		};
+
+		/**
+		 * @brief Gets the value of a field (boolean), converting it on first use.
+		 * @in cfg Lazy view.
+		 * @in field_name Name of field (as string).
+		 * @in default_value Returned if no valid value was given.
+		 */
+		inline bool GetBoolean(LazyConfig *cfg, std::string field_name,
+			bool default_value = false) {
+			MESSAGE *msg = cfg->Fetch(field_name);
+			return msg != nullptr ? GetBoolean(msg, field_name) : default_value;
+		}
+
+		/**
+		 * @brief Gets the value of a field (float), converting it on first use.
+		 * @in cfg Lazy view.
+		 * @in field_name Name of field (as string).
+		 * @in default_value Returned if no valid value was given.
+		 */
+		inline float GetFloat(LazyConfig *cfg, std::string field_name,
+			float default_value = 0.0f) {
+			MESSAGE *msg = cfg->Fetch(field_name);
+			return msg != nullptr ? GetFloat(msg, field_name) : default_value;
+		}
+
+		/**
+		 * @brief Gets the value of a field (double), converting it on first use.
+		 * @in cfg Lazy view.
+		 * @in field_name Name of field (as string).
+		 * @in default_value Returned if no valid value was given.
+		 */
+		inline double GetDouble(LazyConfig *cfg, std::string field_name,
+			double default_value = 0.0) {
+			MESSAGE *msg = cfg->Fetch(field_name);
+			return msg != nullptr ? GetDouble(msg, field_name) : default_value;
+		}
+
+		/**
+		 * @brief Gets the value of a field (int32_t), converting it on first use.
+		 * @in cfg Lazy view.
+		 * @in field_name Name of field (as string).
+		 * @in default_value Returned if no valid value was given.
+		 */
+		inline int32_t GetInt32(LazyConfig *cfg, std::string field_name,
+			int32_t default_value = 0) {
+			MESSAGE *msg = cfg->Fetch(field_name);
+			return msg != nullptr ? GetInt32(msg, field_name) : default_value;
+		}
 
-			// If it is NOT a Protocol Buffer message we are wasting our time
-			// and heading towards a segfault.
-			if (msg == nullptr) {
-				return;
-			}
+		/**
+		 * @brief Gets the value of a field (int64_t), converting it on first use.
+		 * @in cfg Lazy view.
+		 * @in field_name Name of field (as string).
+		 * @in default_value Returned if no valid value was given.
+		 */
+		inline int64_t GetInt64(LazyConfig *cfg, std::string field_name,
+			int64_t default_value = 0) {
+			MESSAGE *msg = cfg->Fetch(field_name);
+			return msg != nullptr ? GetInt64(msg, field_name) : default_value;
+		}
 
-			// Get the descriptor
-			// - This is the 'descriptor'/description of the message.
-			const DESCRIPTOR *descriptor = msg->GetDescriptor();
+		/**
+		 * @brief Gets the value of a field (uint32_t), converting it on first use.
+		 * @in cfg Lazy view.
+		 * @in field_name Name of field (as string).
+		 * @in default_value Returned if no valid value was given.
+		 */
+		inline uint32_t GetUInt32(LazyConfig *cfg, std::string field_name,
+			uint32_t default_value = 0) {
+			MESSAGE *msg = cfg->Fetch(field_name);
+			return msg != nullptr ? GetUInt32(msg, field_name) : default_value;
+		}
 
-			// Get the refl
-			// - This allows for loking into fields for information.
-			const REFLECTION *refl = msg->GetReflection();
+		/**
+		 * @brief Gets the value of a field (uint64_t), converting it on first use.
+		 * @in cfg Lazy view.
+		 * @in field_name Name of field (as string).
+		 * @in default_value Returned if no valid value was given.
+		 */
+		inline uint64_t GetUInt64(LazyConfig *cfg, std::string field_name,
+			uint64_t default_value = 0) {
+			MESSAGE *msg = cfg->Fetch(field_name);
+			return msg != nullptr ? GetUInt64(msg, field_name) : default_value;
+		}
 
-			// Field descriptor (used below)
-			const FIELDDESC *field_descriptor = nullptr;
+		/**
+		 * @brief Gets the value of a field as a string, converting it on first use.
+		 * @in cfg Lazy view.
+		 * @in field_name Name of field (as string).
+		 * @in default_value Returned if no value was given.
+		 */
+		inline std::string GetString(LazyConfig *cfg, std::string field_name,
+			std::string default_value = "") {
+			MESSAGE *msg = cfg->Fetch(field_name);
+			return msg != nullptr ? GetString(msg, field_name) : default_value;
+		}
 
-			// Holder for argv for C++ string manipulation.
-			std::string arg;
+		/**
+		 * @brief Gets the value of an enum field, converting it on first use.
+		 * @in cfg Lazy view.
+		 * @in field_name Name of field (as string).
+		 * @in default_value Returned if no valid value was given.
+		 */
+		inline int32_t GetEnum(LazyConfig *cfg, std::string field_name,
+			int32_t default_value = 0) {
+			MESSAGE *msg = cfg->Fetch(field_name);
+			return msg != nullptr ? GetEnum(msg, field_name) : default_value;
+		}
+#pragma endregion
 
-			// The following two variables are: '--<key>=<val>'
-			std::string key;
-			std::string val;
+#pragma region Cache
+		namespace detail {
+			/**
+			 * @brief 64-bit FNV-1a hash (continues from hash when given).
+			 */
+			inline uint64_t Fnv1a(const void *data, size_t len,
+				uint64_t hash = 14695981039346656037ULL) {
+				const unsigned char *p = static_cast<const unsigned char *>(data);
+				for (size_t i = 0; i < len; i++) {
+					hash ^= p[i];
+					hash *= 1099511628211ULL;
+				}
+				return hash;
+			}
 
-			// Position (usually of '=')
-			size_t pos;
+			/**
+			 * @brief Fingerprint of a message type's schema.
+			 *
+			 * Hashes the message's full name, every extension the parser
+			 * resolves for it or any message type reachable from it (name,
+			 * number and type), and the serialized FileDescriptorProto of each
+			 * file involved and every file those depend on, so any change to
+			 * the .proto definitions, including a new or changed extension in
+			 * another file, gives a new value.
+			 */
+			struct SchemaFingerprint {
+				uint64_t value;
 
-			// Iterate through the incoming arguments
-			for (auto arg : vec) {
-				pos = arg.find("=");
-				if (pos > 0) {
-					key = arg.substr(0, pos);
-					val = arg.substr(pos + 1, arg.length());
-					field_descriptor = nullptr;
-					if (force_lowercase) {
-						std::transform(key.begin(), key.end(), key.begin(), ::tolower);
-						field_descriptor = descriptor->FindFieldByLowercaseName(key);
-					}
-					else {
-						field_descriptor = descriptor->FindFieldByName(key);
-					}
+				explicit SchemaFingerprint(const DESCRIPTOR *desc) {
+					const std::string &name = desc->full_name();
+					value = Fnv1a(name.data(), name.size());
 
-					// If the field descriptor exists
-					if (field_descriptor != nullptr) {
+					std::vector<const ::google::protobuf::FileDescriptor *> files;
+					files.push_back(desc->file());
 
-						switch (field_descriptor->type()) {
-						case FIELDDESC::TYPE_BOOL: {
-							std::transform(val.begin(), val.end(), val.begin(), ::tolower);
-							if (val == "true" || val == "1") {
-								refl->SetBool(msg, field_descriptor, true);
+					// Walk the message types reachable through the field plans.
+					std::vector<const DESCRIPTOR *> types(1, desc);
+					for (size_t t = 0; t < types.size(); t++) {
+						const FieldPlan *plan = GetFieldPlan(types[t]);
+						for (size_t f = 0; f < plan->fields.size(); f++) {
+							const FIELDDESC *field = plan->fields[f].field;
+							if (field->is_extension()) {
+								const std::string &ext_name = field->full_name();
+								int32_t number = field->number();
+								int32_t type = static_cast<int32_t>(field->type());
+								value = Fnv1a(ext_name.data(), ext_name.size(), value);
+								value = Fnv1a(&number, sizeof(number), value);
+								value = Fnv1a(&type, sizeof(type), value);
+								if (std::find(files.begin(), files.end(), field->file()) == files.end()) {
+									files.push_back(field->file());
+								}
 							}
-							else {
-								refl->SetBool(msg, field_descriptor, false);
+							const DESCRIPTOR *type_desc = field->message_type();
+							if (type_desc != nullptr &&
+								std::find(types.begin(), types.end(), type_desc) == types.end()) {
+								types.push_back(type_desc);
 							}
-						} break;
+						}
+					}
 
-						case FIELDDESC::TYPE_BYTES:
-						case FIELDDESC::TYPE_STRING: {
-							refl->SetString(msg, field_descriptor, val);
-						} break;
+					std::string bytes;
+					for (size_t i = 0; i < files.size(); i++) {
+						const ::google::protobuf::FileDescriptor *file = files[i];
+						::google::protobuf::FileDescriptorProto proto;
+						file->CopyTo(&proto);
+						proto.SerializeToString(&bytes);
+						value = Fnv1a(bytes.data(), bytes.size(), value);
 
-						case FIELDDESC::TYPE_DOUBLE: {
-							refl->SetDouble(msg, field_descriptor, std::stod(val));
-						} break;
+						for (int d = 0; d < file->dependency_count(); d++) {
+							const ::google::protobuf::FileDescriptor *dep = file->dependency(d);
+							if (std::find(files.begin(), files.end(), dep) == files.end()) {
+								files.push_back(dep);
+							}
+						}
+					}
+				}
+			};
 
-						case FIELDDESC::TYPE_ENUM: {
-
-							// Attempt to get the enum descriptor
-							const ::google::protobuf::EnumDescriptor *enum_desc =
-								descriptor->FindEnumTypeByName(field_descriptor->enum_type()->name());
-
-							if (enum_desc != nullptr) {
-								const ::google::protobuf::EnumValueDescriptor *enum_value_desc = nullptr;
-
-								// try incoming
-								enum_value_desc = enum_desc->FindValueByName(val);
-								if (enum_value_desc == nullptr) {
-									// try lower
-									std::transform(val.begin(), val.end(), val.begin(), ::tolower);
-									enum_value_desc = enum_desc->FindValueByName(val);
-									if (enum_value_desc == nullptr) {
-										// try upper 
-										std::transform(val.begin(), val.end(), val.begin(), ::toupper);
-										enum_value_desc = enum_desc->FindValueByName(val);
-										if (enum_value_desc == nullptr) {
-											// try number
-											int ival = std::stol(val);
-											enum_value_desc = enum_desc->FindValueByNumber(ival);
-										}
-									}
-								}
+			/**
+			 * @brief Header in front of each cache entry.
+			 *
+			 * The header is followed by the input the entry was written for
+			 * (input_size bytes), the message's prior contents (prior_size
+			 * bytes) and the parsed message (size bytes).  A load compares the
+			 * input and prior bytes, so a key collision is a miss.
+			 */
+			struct CacheHeader {
+				char magic[8];
+				uint64_t fingerprint;
+				uint64_t key;
+				uint64_t input_size;
+				uint64_t prior_size;
+				uint64_t size;
+			};
 
-								// If we have a value, update enum_value
-								if (enum_value_desc != nullptr) {
-									refl->SetEnum(msg, field_descriptor, enum_value_desc);
-								}
-							}
-						} break;
+			inline const char *CacheMagic() {
+				return "AWSPPC3";
+			}
 
-						case FIELDDESC::TYPE_FIXED32:
-						case FIELDDESC::TYPE_UINT32: {
-							refl->SetUInt32(msg, field_descriptor, std::stoul(val));
-						} break;
+			/**
+			 * @brief Path of the cache entry for a key.
+			 */
+			inline std::string CachePath(const std::string &cache_dir, uint64_t key) {
+				static const char hex[] = "0123456789abcdef";
+				std::string path = cache_dir;
+				if (!path.empty() && path[path.size() - 1] != '/') {
+					path.push_back('/');
+				}
+				for (int shift = 60; shift >= 0; shift -= 4) {
+					path.push_back(hex[(key >> shift) & 0xF]);
+				}
+				path.append(".pbc");
+				return path;
+			}
 
-						case FIELDDESC::TYPE_FIXED64:
-						case FIELDDESC::TYPE_UINT64: {
-							refl->SetUInt64(msg, field_descriptor, std::stoull(val));
-						} break;
+#if !defined(_WIN32)
+			/**
+			 * @brief Replaces msg with a cached message, if a valid entry exists.
+			 * @in input Key material the entry must have been written for.
+			 * @in prior msg as serialized before; restored if the entry is corrupt.
+			 * @return True on a hit.  Entries from another schema, or for other
+			 *   input with the same key, are removed; entries owned by another
+			 *   user are ignored.
+			 */
+			inline bool LoadCached(const std::string &path, uint64_t fingerprint,
+				uint64_t key, const std::string &input, const std::string &prior, MESSAGE *msg) {
 
-						case FIELDDESC::TYPE_FLOAT: {
-							refl->SetFloat(msg, field_descriptor, std::stof(val));
-						} break;
+				int fd = ::open(path.c_str(), O_RDONLY);
+				if (fd < 0) {
+					return false;
+				}
 
-						case FIELDDESC::TYPE_GROUP: {
-							// todo ?
-							// - Probably shouldn't be used anyway.
-						} break;
+				bool hit = false;
+				bool stale = false;
+				struct stat st;
+				if (::fstat(fd, &st) == 0 && st.st_uid == ::geteuid() &&
+					static_cast<size_t>(st.st_size) >= sizeof(CacheHeader)) {
 
-						case FIELDDESC::TYPE_MESSAGE:{
-							// Experimental and unrecommended.
+					size_t size = static_cast<size_t>(st.st_size);
+					void *map = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+					if (map != MAP_FAILED) {
+						CacheHeader header;
+						memcpy(&header, map, sizeof(header));
+						const uint8_t *stored = static_cast<const uint8_t *>(map) + sizeof(header);
+						size_t left = size - sizeof(header);
+
+						if (memcmp(header.magic, CacheMagic(), sizeof(header.magic)) != 0 ||
+							header.fingerprint != fingerprint || header.key != key ||
+							header.input_size != input.size() || header.prior_size != prior.size() ||
+							header.input_size + header.prior_size > left ||
+							header.size != left - input.size() - prior.size() || header.size > INT_MAX ||
+							memcmp(stored, input.data(), input.size()) != 0 ||
+							memcmp(stored + input.size(), prior.data(), prior.size()) != 0) {
+							stale = true;
+						}
+						else {
+							const uint8_t *payload = stored + input.size() + prior.size();
+							::google::protobuf::io::CodedInputStream in(payload, static_cast<int>(header.size));
+							msg->Clear();
+							hit = msg->MergePartialFromCodedStream(&in);
+							if (!hit) {
+								msg->Clear();
+								msg->ParsePartialFromString(prior);
+								stale = true;
+							}
+						}
+						::munmap(map, size);
+					}
+				}
+				::close(fd);
 
-							// Get the value as a string stream
-							std::stringstream ss(val);
+				if (stale) {
+					::unlink(path.c_str());
+				}
+				return hit;
+			}
 
-							// Set iteration pointers
-							std::istream_iterator<std::string> begin(ss);
-							std::istream_iterator<std::string> end;
+			/**
+			 * @brief Writes a cache entry (atomically, via rename).  Best effort.
+			 */
+			inline void StoreCached(const std::string &path, uint64_t fingerprint,
+				uint64_t key, const std::string &input, const std::string &prior, const MESSAGE &msg) {
 
-							// Set storage
-							std::vector<std::string> internal_vec(begin, end);
+				std::string payload;
+				if (!msg.SerializePartialToString(&payload)) {
+					return;
+				}
 
-							// -- STL MAGIC -- Tokens!
+				CacheHeader header;
+				memcpy(header.magic, CacheMagic(), sizeof(header.magic));
+				header.fingerprint = fingerprint;
+				header.key = key;
+				header.input_size = input.size();
+				header.prior_size = prior.size();
+				header.size = payload.size();
 
-							// Get the internal message from the field descriptor.
-							MESSAGE *internal_message = refl->MutableMessage(msg, field_descriptor);
+				std::string tmp = path;
+				tmp.append(".tmp.");
+				Writer name(&tmp);
+				name.WriteInt64(static_cast<int64_t>(::getpid()));
+				name.Flush();
 
-							// Now process it ...
-							Parse(internal_vec, internal_message, force_lowercase);
-						} break;
+				int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+				if (fd < 0) {
+					return;
+				}
+				bool ok;
+				{
+					Writer out(fd);
+					out.Write(reinterpret_cast<const char *>(&header), sizeof(header));
+					out.Write(input);
+					out.Write(prior);
+					out.Write(payload);
+					ok = out.Flush();
+				}
+				ok = (::close(fd) == 0) && ok;
 
-						case FIELDDESC::TYPE_SFIXED32:
-						case FIELDDESC::TYPE_INT32: {
-							refl->SetInt32(msg, field_descriptor, std::stol(val));
-						} break;
+				if (!ok || ::rename(tmp.c_str(), path.c_str()) != 0) {
+					::unlink(tmp.c_str());
+				}
+			}
+#endif
 
-						case FIELDDESC::TYPE_SFIXED64:
-						case FIELDDESC::TYPE_INT64: {
-							refl->SetInt64(msg, field_descriptor, std::stoll(val));
-						} break;
+			/**
+			 * @brief Looks up a cache entry for input, or parses and stores one.
+			 * @in input Key material: options and the exact input bytes.
+			 * @in parse Callable parsing into a message (the cache miss path).
+			 * @return True on a cache hit.
+			 *
+			 * Entries hold the complete message after parsing and are keyed on
+			 * what msg held before as well as on the input, so a hit leaves msg
+			 * exactly as Parse would (merging a separately parsed message would
+			 * lose values Parse sets to their proto3 default).
+			 */
+			template <typename ParseFunction>
+			inline bool ParseThroughCache(MESSAGE *msg, const std::string &cache_dir,
+				const std::string &input, ParseFunction parse) {
+#if !defined(_WIN32)
+				const DESCRIPTOR *desc = msg->GetDescriptor();
+				uint64_t fingerprint = CachedMetadata<SchemaFingerprint>(desc)->value;
+				std::string prior;
+				msg->SerializePartialToString(&prior);
+				uint64_t key = Fnv1a(input.data(), input.size());
+				key = Fnv1a(&fingerprint, sizeof(fingerprint), key);
+				key = Fnv1a(prior.data(), prior.size(), key);
+				std::string path = CachePath(cache_dir, key);
 
-							// Problem or out of date support.
-						default: break;
-						}
-					}
+				if (LoadCached(path, fingerprint, key, input, prior, msg)) {
+					return true;
 				}
+
+				parse(msg);
+				StoreCached(path, fingerprint, key, input, prior, *msg);
+				return false;
+#else
+				(void)cache_dir;
+				(void)input;
+				parse(msg);
+				return false;
+#endif
+			}
+
+			/**
+			 * @brief Starts the key material of an input (kind and options).
+			 */
+			inline std::string CacheInput(char kind, bool force_lowercase) {
+				std::string input("v");
+				input.push_back(kind);
+				input.push_back(force_lowercase ? 'l' : '-');
+				return input;
 			}
 		}
 
 		/**
-		 * @brief Processes argc/argv into a message (where fields match).
+		 * @brief Processes argc/argv into a message through an on-disk cache.
 		 * @in argc 'argc' from the main function/entry point.
 		 * @in argv 'argv' from the main function/entry point.
 		 * @in msg A Google Protocol Buffer message.
+		 * @in cache_dir Existing directory for cache entries.
 		 * @in force_lowercase If true the field will be searched for in lowercase.
+		 * @return True if the result came from the cache.
+		 *
+		 * Entries are keyed by a hash of the arguments, the message schema (see
+		 * detail::SchemaFingerprint) and the message's prior contents, and hold
+		 * the parsed message in wire format; a hit maps the file and loads it
+		 * instead of parsing.  Each entry also holds the arguments and prior
+		 * contents themselves, compared on load, so a hash collision is only
+		 * a miss.  Entries are created 0600 and entries owned by another user
+		 * are never loaded.  Entries written for an older schema never match
+		 * and are deleted when seen.
+		 * On Windows this is the same as Parse.
 		 */
-		inline void Parse(int argc, char **argv,
-			MESSAGE *msg, bool force_lowercase = false) {
+		inline bool ParseCached(int argc, char **argv, MESSAGE *msg,
+			const std::string &cache_dir, bool force_lowercase = false) {
 
-			// If it is NOT a Protocol Buffer message we are wasting our time
-			// and heading towards a segfault.
 			if (msg == nullptr) {
-				return;
+				return false;
 			}
 
-			// Turn it into a vector
-			std::vector<std::string> args;
-			std::string arg;
+			std::string input = detail::CacheInput('a', force_lowercase);
 			for (int i = 1; i < argc; i++) {
-				if (argv[i][0] == '-' && argv[i][1] == '-') {
-					arg = std::string(argv[i]);
-					arg = arg.substr(2, arg.length());
-					args.push_back(std::string(arg));
-				}
+				size_t len = strlen(argv[i]);
+				input.append(reinterpret_cast<const char *>(&len), sizeof(len));
+				input.append(argv[i], len);
 			}
 
-			// Call the actual parser now.
-			Parse(args, msg, force_lowercase);
+			struct ArgvParser {
+				int argc;
+				char **argv;
+				bool force_lowercase;
+				void operator()(MESSAGE *m) const {
+					Parse(argc, argv, m, force_lowercase);
+				}
+			};
+			ArgvParser parser = { argc, argv, force_lowercase };
+			return detail::ParseThroughCache(msg, cache_dir, input, parser);
 		}
 
 		/**
-		 * @brief Dumps a Message to string.
+		 * @brief Processes a buffer (as ParseBuffer) through an on-disk cache.
+		 * @in data Buffer; need not be NUL terminated.
+		 * @in len Length of the buffer.
+		 * @in msg A Google Protocol Buffer message.
+		 * @in cache_dir Existing directory for cache entries.
+		 * @in force_lowercase If true the field will be searched for in lowercase.
+		 * @return True if the result came from the cache.
 		 */
-		inline std::string Dump(MESSAGE *msg, int indent = 0) {
-			const DESCRIPTOR *desc = msg->GetDescriptor();
-			const REFLECTION *refl = msg->GetReflection();
-			const FIELDDESC *field;
+		inline bool ParseBufferCached(const char *data, size_t len, MESSAGE *msg,
+			const std::string &cache_dir, bool force_lowercase = false) {
 
-			std::stringstream ss;
-			std::string fname;
-			std::string out;
-			int count = desc->field_count();
-			for (int i = 0; i < count; i++) {
-				field = desc->field(i);
-				fname = field->name();
+			if (msg == nullptr || data == nullptr) {
+				return false;
+			}
+
+			std::string input = detail::CacheInput('b', force_lowercase);
+			input.append(data, len);
 
-				for (int j = 0; j < indent; j++) {
-					ss << "\t";
+			struct BufferParser {
+				const char *data;
+				size_t len;
+				bool force_lowercase;
+				void operator()(MESSAGE *m) const {
+					ParseBuffer(data, len, m, force_lowercase);
 				}
+			};
+			BufferParser parser = { data, len, force_lowercase };
+			return detail::ParseThroughCache(msg, cache_dir, input, parser);
+		}
+#pragma endregion
 
-				if (field->type() == FIELDDESC::TYPE_MESSAGE) {
-					ss << "[message] `" << fname << "'" << std::endl;
-					ss << GetAsString(msg, fname, indent);
-				} else {
-					ss << "`" << fname << "' = `"
-						<< GetAsString(msg, fname, indent)
-						<< "'\n";
+#pragma region SharedConfig
+#if !defined(_WIN32)
+		namespace detail {
+			/**
+			 * @brief Layout at the start of a shared config segment.
+			 *
+			 * The payload (the message in wire format) follows the header.
+			 * sequence is odd while the publisher is writing; readers retry if
+			 * it is odd or changes while they read (a seqlock).
+			 */
+			struct SharedConfigHeader {
+				char magic[8];
+				uint64_t fingerprint;
+				uint64_t capacity;
+				std::atomic<uint64_t> sequence;
+				uint64_t size;
+			};
+
+			inline const char *SharedConfigMagic() {
+				return "AWSPPS1";
+			}
+
+			/**
+			 * @brief shm_open requires a leading '/'.
+			 */
+			inline std::string SharedConfigName(const std::string &name) {
+				if (!name.empty() && name[0] == '/') {
+					return name;
 				}
+				return "/" + name;
 			}
-			out = ss.str();
-			return out;
 		}
+
+		/**
+		 * @brief Publishes a parsed config to other processes on the host.
+		 *
+		 * The message is serialized into a POSIX shared-memory segment which
+		 * SharedConfigReader maps read-only.  There must be a single publisher
+		 * per segment.  Link with -lrt on older glibc.
+		 */
+		class SharedConfigPublisher {
+		public:
+			SharedConfigPublisher() : header_(nullptr), mapped_(0) {
+			}
+
+			~SharedConfigPublisher() {
+				Close();
+			}
+
+			/**
+			 * @brief Creates (or reuses) the segment.
+			 * @in name Segment name (as shm_open; a leading '/' is added if missing).
+			 * @in prototype Any message of the type to publish.
+			 * @in capacity Largest serialized message that can be published.
+			 * @in mode Permissions of the segment, set whether it is new or
+			 *   reused (the umask does not apply).  Readers running as other
+			 *   users need read access, e.g. 0640 or 0644.
+			 * @return True if the segment is mapped; false if it cannot be, or
+			 *   an existing segment belongs to another user.
+			 */
+			bool Open(const std::string &name, const MESSAGE &prototype, size_t capacity,
+				mode_t mode = 0600) {
+				Close();
+
+				int fd = ::shm_open(detail::SharedConfigName(name).c_str(), O_RDWR | O_CREAT, mode & 0777);
+				if (fd < 0) {
+					return false;
+				}
+
+				size_t size = sizeof(detail::SharedConfigHeader) + capacity;
+				struct stat st;
+				if (::fstat(fd, &st) != 0 || st.st_uid != ::geteuid() ||
+					((st.st_mode & 0777) != (mode & 0777) && ::fchmod(fd, mode & 0777) != 0) ||
+					(static_cast<size_t>(st.st_size) < size && ::ftruncate(fd, static_cast<off_t>(size)) != 0)) {
+					::close(fd);
+					return false;
+				}
+				if (static_cast<size_t>(st.st_size) > size) {
+					size = static_cast<size_t>(st.st_size);
+				}
+
+				void *map = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+				::close(fd);
+				if (map == MAP_FAILED) {
+					return false;
+				}
+				header_ = static_cast<detail::SharedConfigHeader *>(map);
+				mapped_ = size;
+
+				// (Re)initialise a new segment, or one left by another schema.
+				uint64_t fingerprint =
+					detail::CachedMetadata<detail::SchemaFingerprint>(prototype.GetDescriptor())->value;
+				if (memcmp(header_->magic, detail::SharedConfigMagic(), sizeof(header_->magic)) != 0 ||
+					header_->fingerprint != fingerprint) {
+					new (&header_->sequence) std::atomic<uint64_t>(0);
+					header_->fingerprint = fingerprint;
+					header_->size = 0;
+					memcpy(header_->magic, detail::SharedConfigMagic(), sizeof(header_->magic));
+				}
+				header_->capacity = size - sizeof(detail::SharedConfigHeader);
+
+				if (!header_->sequence.is_lock_free()) {
+					Close();
+					return false;
+				}
+				return true;
+			}
+
+			/**
+			 * @brief Serializes a message straight into the segment.
+			 * @return False if not open or the message exceeds the capacity.
+			 */
+			bool Publish(const MESSAGE &msg) {
+				if (header_ == nullptr) {
+					return false;
+				}
+				// Bounded by this mapping: the header is writable by anyone.
+				size_t size = msg.ByteSizeLong();
+				if (size > mapped_ - sizeof(detail::SharedConfigHeader) || size > INT_MAX) {
+					return false;
+				}
+
+				uint8_t *payload = reinterpret_cast<uint8_t *>(header_ + 1);
+				uint64_t seq = header_->sequence.load(std::memory_order_relaxed);
+				header_->sequence.store(seq + 1, std::memory_order_relaxed);
+				std::atomic_thread_fence(std::memory_order_release);
+
+				msg.SerializeWithCachedSizesToArray(payload);
+				header_->size = size;
+
+				header_->sequence.store(seq + 2, std::memory_order_release);
+				return true;
+			}
+
+			/**
+			 * @brief Parses argc/argv once (as Parse) and publishes the result.
+			 * @in prototype Any message of the published type.
+			 */
+			bool Publish(int argc, char **argv, const MESSAGE &prototype,
+				bool force_lowercase = false) {
+				MESSAGE *msg = prototype.New();
+				Parse(argc, argv, msg, force_lowercase);
+				bool rv = Publish(*msg);
+				delete msg;
+				return rv;
+			}
+
+			/**
+			 * @brief Number of completed publications.
+			 */
+			uint64_t Generation() const {
+				if (header_ == nullptr) {
+					return 0;
+				}
+				return header_->sequence.load(std::memory_order_acquire) / 2;
+			}
+
+			void Close() {
+				if (header_ != nullptr) {
+					::munmap(header_, mapped_);
+					header_ = nullptr;
+					mapped_ = 0;
+				}
+			}
+
+			/**
+			 * @brief Removes a segment name (mapped segments stay valid).
+			 */
+			static bool Unlink(const std::string &name) {
+				return ::shm_unlink(detail::SharedConfigName(name).c_str()) == 0;
+			}
+
+		private:
+			SharedConfigPublisher(const SharedConfigPublisher &);
+			SharedConfigPublisher &operator=(const SharedConfigPublisher &);
+
+			detail::SharedConfigHeader *header_;
+			size_t mapped_;
+		};
+
+		/**
+		 * @brief Reads a config published by SharedConfigPublisher.
+		 *
+		 * The segment is mapped read-only and Read() parses straight from the
+		 * mapping, without an intermediate copy.  It is not zero-copy field
+		 * access: every call deserializes the whole message, so callers that
+		 * poll should compare Generation() first and only Read() when it has
+		 * moved.  (Decoding fields in place would tie readers to the wire
+		 * layout of one schema version; a full parse keeps unknown fields
+		 * and schema evolution working as for any other message.)
+		 * Reads never go past the reader's own mapping, whatever the header
+		 * says; if the publisher reopens the segment with a larger capacity,
+		 * Read() maps it again.  The segment must never shrink.
+		 */
+		class SharedConfigReader {
+		public:
+			SharedConfigReader() : header_(nullptr), mapped_(0), fingerprint_(0) {
+			}
+
+			~SharedConfigReader() {
+				Close();
+			}
+
+			/**
+			 * @brief Maps an existing segment.
+			 * @in name Segment name, as given to the publisher.
+			 * @in prototype Any message of the published type.
+			 * @return False if there is no segment, or it holds another schema.
+			 */
+			bool Open(const std::string &name, const MESSAGE &prototype) {
+				Close();
+				name_ = detail::SharedConfigName(name);
+				fingerprint_ =
+					detail::CachedMetadata<detail::SchemaFingerprint>(prototype.GetDescriptor())->value;
+				if (!Map(0)) {
+					return false;
+				}
+				if (memcmp(header_->magic, detail::SharedConfigMagic(), sizeof(header_->magic)) != 0 ||
+					header_->fingerprint != fingerprint_) {
+					Close();
+					return false;
+				}
+				return true;
+			}
+
+			/**
+			 * @brief Number of completed publications (0 if nothing is published).
+			 */
+			uint64_t Generation() const {
+				if (header_ == nullptr) {
+					return 0;
+				}
+				return header_->sequence.load(std::memory_order_acquire) / 2;
+			}
+
+			/**
+			 * @brief Reads the latest published message (a full parse).
+			 * @in msg Message to replace with the published one.
+			 * @out generation Generation read (optional).
+			 * @return False if not open, nothing is published yet, or the
+			 *   publisher kept writing for the whole retry budget.
+			 */
+			bool Read(MESSAGE *msg, uint64_t *generation = nullptr) {
+				if (header_ == nullptr || msg == nullptr) {
+					return false;
+				}
+
+				for (int attempt = 0; attempt < 1000; attempt++) {
+					uint64_t before = header_->sequence.load(std::memory_order_acquire);
+					if (before == 0) {
+						return false;
+					}
+					if (before & 1) {
+						sched_yield();
+						continue;
+					}
+
+					// The header may say anything; only the mapping is trusted.
+					uint64_t size = header_->size;
+					uint64_t mapped_capacity = mapped_ - sizeof(detail::SharedConfigHeader);
+					if (size > mapped_capacity) {
+						if (header_->capacity > mapped_capacity) {
+							// Grown by the publisher: map the larger segment.
+							if (!Map(mapped_) || header_->fingerprint != fingerprint_) {
+								Close();
+								return false;
+							}
+						}
+						continue;
+					}
+
+					const uint8_t *payload = reinterpret_cast<const uint8_t *>(header_ + 1);
+					bool parsed = size <= INT_MAX &&
+						msg->ParseFromArray(payload, static_cast<int>(size));
+
+					std::atomic_thread_fence(std::memory_order_acquire);
+					if (header_->sequence.load(std::memory_order_relaxed) == before && parsed) {
+						if (generation != nullptr) {
+							*generation = before / 2;
+						}
+						return true;
+					}
+				}
+				return false;
+			}
+
+			void Close() {
+				if (header_ != nullptr) {
+					::munmap(const_cast<detail::SharedConfigHeader *>(header_), mapped_);
+					header_ = nullptr;
+					mapped_ = 0;
+				}
+			}
+
+		private:
+			SharedConfigReader(const SharedConfigReader &);
+			SharedConfigReader &operator=(const SharedConfigReader &);
+
+			/**
+			 * @brief Maps the segment (again) at its current size.
+			 * @in larger_than Fail unless the segment is larger than this.
+			 * @return False (the old mapping kept) if it cannot be mapped.
+			 */
+			bool Map(size_t larger_than) {
+				int fd = ::shm_open(name_.c_str(), O_RDONLY, 0);
+				if (fd < 0) {
+					return false;
+				}
+				struct stat st;
+				if (::fstat(fd, &st) != 0 ||
+					static_cast<size_t>(st.st_size) < sizeof(detail::SharedConfigHeader) ||
+					static_cast<size_t>(st.st_size) <= larger_than) {
+					::close(fd);
+					return false;
+				}
+
+				size_t size = static_cast<size_t>(st.st_size);
+				void *map = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+				::close(fd);
+				if (map == MAP_FAILED) {
+					return false;
+				}
+				Close();
+				header_ = static_cast<const detail::SharedConfigHeader *>(map);
+				mapped_ = size;
+				return true;
+			}
+
+			const detail::SharedConfigHeader *header_;
+			size_t mapped_;
+			std::string name_;
+			uint64_t fingerprint_;
+		};
+#endif
+#pragma endregion
+
+#pragma region Columnar
+		/**
+		 * @brief Parses records straight into per-field column buffers.
+		 *
+		 * Built from a message type: every scalar field becomes a column, and
+		 * fields of nested messages become dotted columns ("Outer.Inner").
+		 * Each appended record adds one row to every column; a field the record
+		 * does not give (or gives a malformed value for) is left null in the
+		 * validity bitmap.  No message is built per record.
+		 *
+		 * Values are converted as Parse converts them: the last value given for
+		 * a field wins, as does the last oneof member given a well-formed
+		 * value.  Fields of a message type already being expanded (recursive
+		 * messages) and repeated fields get no column.  Not thread-safe.
+		 */
+		class ColumnarSink {
+		public:
+			/**
+			 * @brief One column; only the vector matching cpp_type is used.
+			 */
+			struct Column {
+				// Dotted field path from the top level message.
+				std::string name;
+				const FIELDDESC *field;
+				FIELDDESC::CppType cpp_type;
+
+				// Bit (row % 64) of word (row / 64) is set if the row has a value.
+				std::vector<uint64_t> validity;
+
+				std::vector<int32_t> int32_values;		// CPPTYPE_INT32, CPPTYPE_ENUM (number)
+				std::vector<int64_t> int64_values;		// CPPTYPE_INT64
+				std::vector<uint32_t> uint32_values;	// CPPTYPE_UINT32
+				std::vector<uint64_t> uint64_values;	// CPPTYPE_UINT64
+				std::vector<float> float_values;		// CPPTYPE_FLOAT
+				std::vector<double> double_values;		// CPPTYPE_DOUBLE
+				std::vector<uint8_t> bool_values;		// CPPTYPE_BOOL
+
+				// CPPTYPE_STRING: row i is data[offsets[i], offsets[i + 1]).
+				std::vector<uint64_t> offsets;
+				std::string data;
+
+				/**
+				 * @brief Checks if a row holds a value.
+				 */
+				bool IsValid(size_t row) const {
+					return (validity[row >> 6] >> (row & 63)) & 1;
+				}
+			};
+
+			/**
+			 * @brief Lays out the columns for a message type.
+			 * @in prototype Any message of the record type.
+			 * @in force_lowercase If true fields will be searched for in lowercase.
+			 */
+			explicit ColumnarSink(const MESSAGE &prototype, bool force_lowercase = false)
+				: rows_(0), force_lowercase_(force_lowercase) {
+				std::vector<const DESCRIPTOR *> path;
+				Layout(prototype.GetDescriptor(), "", path);
+				Clear();
+			}
+
+			/**
+			 * @brief Appends one record given as argc/argv ('--key=value').
+			 */
+			void Append(int argc, char **argv) {
+				BeginRow();
+				const detail::FieldPlan *plan = nodes_[0].plan;
+				detail::BeginLevel(ctx_, 0);
+				detail::ResolveArgv(ctx_, plan, argc, argv, force_lowercase_);
+				Store(0, 0);
+			}
+
+			/**
+			 * @brief Appends one record given as a 'key=value' buffer (as ParseBuffer).
+			 * @in data Record; need not be NUL terminated.
+			 * @in len Length of the record (less than 4GiB).
+			 */
+			void AppendBuffer(const char *data, size_t len) {
+				if (data == nullptr || len > UINT32_MAX) {
+					return;
+				}
+				BeginRow();
+				detail::BeginLevel(ctx_, 0);
+				detail::ResolveBuffer(ctx_, nodes_[0].plan, 0, data, len, force_lowercase_);
+				Store(0, 0);
+			}
+
+			/**
+			 * @brief Appends newline separated records, one row per non-empty line.
+			 * @in data Records; need not be NUL terminated.
+			 * @in len Length of data.
+			 */
+			void AppendLines(const char *data, size_t len) {
+				const char *end = data + len;
+				while (data != nullptr && data < end) {
+					const char *nl = static_cast<const char *>(memchr(data, '\n', static_cast<size_t>(end - data)));
+					const char *line_end = nl != nullptr ? nl : end;
+					if (line_end > data) {
+						AppendBuffer(data, static_cast<size_t>(line_end - data));
+					}
+					data = line_end + 1;
+				}
+			}
+
+			/**
+			 * @brief Drops every row (keeping the columns and their capacity).
+			 */
+			void Clear() {
+				rows_ = 0;
+				for (size_t i = 0; i < columns_.size(); i++) {
+					Column &column = columns_[i];
+					column.validity.clear();
+					column.int32_values.clear();
+					column.int64_values.clear();
+					column.uint32_values.clear();
+					column.uint64_values.clear();
+					column.float_values.clear();
+					column.double_values.clear();
+					column.bool_values.clear();
+					column.offsets.assign(column.cpp_type == FIELDDESC::CPPTYPE_STRING ? 1 : 0, 0);
+					column.data.clear();
+				}
+			}
+
+			size_t Rows() const {
+				return rows_;
+			}
+
+			const std::vector<Column> &Columns() const {
+				return columns_;
+			}
+
+			/**
+			 * @brief Finds a column by dotted name.
+			 * @return Column, or nullptr if there is no such column.
+			 */
+			const Column *FindColumn(const std::string &name) const {
+				for (size_t i = 0; i < columns_.size(); i++) {
+					if (columns_[i].name == name) {
+						return &columns_[i];
+					}
+				}
+				return nullptr;
+			}
+
+		private:
+			ColumnarSink(const ColumnarSink &);
+			ColumnarSink &operator=(const ColumnarSink &);
+
+			/**
+			 * @brief Where the fields of one (possibly nested) message go.
+			 *
+			 * column and child are indexed like plan->fields; -1 if unused.
+			 */
+			struct Node {
+				const detail::FieldPlan *plan;
+				std::vector<int> column;
+				std::vector<int> child;
+			};
+
+			/**
+			 * @brief Adds the node (and columns) for a message type.
+			 * @return Index of the node in nodes_.
+			 */
+			int Layout(const DESCRIPTOR *desc, const std::string &prefix,
+				std::vector<const DESCRIPTOR *> &path) {
+
+				int index = static_cast<int>(nodes_.size());
+				nodes_.push_back(Node());
+				const detail::FieldPlan *plan = detail::GetFieldPlan(desc);
+				nodes_[index].plan = plan;
+				nodes_[index].column.assign(plan->fields.size(), -1);
+				nodes_[index].child.assign(plan->fields.size(), -1);
+
+				path.push_back(desc);
+				for (size_t i = 0; i < plan->fields.size(); i++) {
+					const detail::FieldPlanEntry &entry = plan->fields[i];
+					const std::string name = prefix + entry.name;
+
+					if (entry.type == FIELDDESC::TYPE_GROUP) {
+						continue;
+					}
+					if (entry.type == FIELDDESC::TYPE_MESSAGE) {
+						const DESCRIPTOR *nested = entry.field->message_type();
+						if (std::find(path.begin(), path.end(), nested) == path.end()) {
+							int child = Layout(nested, name + ".", path);
+							nodes_[index].child[i] = child;
+						}
+						continue;
+					}
+
+					Column column;
+					column.name = name;
+					column.field = entry.field;
+					column.cpp_type = entry.field->cpp_type();
+					nodes_[index].column[i] = static_cast<int>(columns_.size());
+					columns_.push_back(column);
+				}
+				path.pop_back();
+				return index;
+			}
+
+			/**
+			 * @brief Adds a null row to every column.
+			 */
+			void BeginRow() {
+				size_t row = rows_++;
+				for (size_t i = 0; i < columns_.size(); i++) {
+					Column &column = columns_[i];
+					if ((row & 63) == 0) {
+						column.validity.push_back(0);
+					}
+					switch (column.cpp_type) {
+					case FIELDDESC::CPPTYPE_ENUM:
+					case FIELDDESC::CPPTYPE_INT32: column.int32_values.push_back(0); break;
+					case FIELDDESC::CPPTYPE_INT64: column.int64_values.push_back(0); break;
+					case FIELDDESC::CPPTYPE_UINT32: column.uint32_values.push_back(0); break;
+					case FIELDDESC::CPPTYPE_UINT64: column.uint64_values.push_back(0); break;
+					case FIELDDESC::CPPTYPE_FLOAT: column.float_values.push_back(0.0f); break;
+					case FIELDDESC::CPPTYPE_DOUBLE: column.double_values.push_back(0.0); break;
+					case FIELDDESC::CPPTYPE_BOOL: column.bool_values.push_back(0); break;
+					case FIELDDESC::CPPTYPE_STRING: column.offsets.push_back(column.data.size()); break;
+					default: break;
+					}
+				}
+			}
+
+			/**
+			 * @brief Stores the arguments queued at a depth into the current row.
+			 * @in node Index of the node the level was resolved against.
+			 * @in level Nesting depth (index into ctx_.levels).
+			 */
+			void Store(int node, size_t level) {
+				detail::ParseLevel &lv = ctx_.levels[level];
+				const detail::FieldPlan *plan = nodes_[node].plan;
+				detail::ApplyLevel(lv, plan, [&](size_t i) {
+					const detail::PendingArgument &pending = lv.pending[i];
+					size_t f = static_cast<size_t>(pending.entry - &plan->fields[0]);
+					ctx_.val.assign(pending.value, pending.len);
+					if (pending.quoted) {
+						detail::Unquote(ctx_.val);
+					}
+
+					int child = nodes_[node].child[f];
+					if (child >= 0) {
+						detail::ParseLevel &next = detail::BeginLevel(ctx_, level + 1);
+						next.text.assign(ctx_.val);
+						detail::ResolveBuffer(ctx_, nodes_[child].plan, level + 1,
+							next.text.data(), next.text.size(), force_lowercase_);
+						Store(child, level + 1);
+						return true;
+					}
+					if (nodes_[node].column[f] >= 0) {
+						return StoreValue(columns_[static_cast<size_t>(nodes_[node].column[f])], *pending.entry);
+					}
+					return true;
+				});
+			}
+
+			/**
+			 * @brief Converts ctx_.val into the current row of a column.
+			 *
+			 * Malformed values leave the row as it was.
+			 */
+			bool StoreValue(Column &column, const detail::FieldPlanEntry &entry) {
+				size_t row = rows_ - 1;
+				std::string &val = ctx_.val;
+				bool ok = false;
+
+				switch (column.cpp_type) {
+				case FIELDDESC::CPPTYPE_ENUM: {
+					const ENUMVALUEDESC *value = detail::FindEnumValue(entry, val);
+					if (value != nullptr) {
+						column.int32_values[row] = value->number();
+						ok = true;
+					}
+					else if (entry.enum_meta->open) {
+						ok = detail::ToInt32(val, column.int32_values[row]);
+					}
+				} break;
+				case FIELDDESC::CPPTYPE_INT32:
+					ok = detail::ToInt32(val, column.int32_values[row]);
+					break;
+				case FIELDDESC::CPPTYPE_INT64:
+					ok = detail::ToInt64(val, column.int64_values[row]);
+					break;
+				case FIELDDESC::CPPTYPE_UINT32:
+					ok = detail::ToUInt32(val, column.uint32_values[row]);
+					break;
+				case FIELDDESC::CPPTYPE_UINT64:
+					ok = detail::ToUInt64(val, column.uint64_values[row]);
+					break;
+				case FIELDDESC::CPPTYPE_FLOAT:
+					ok = detail::ToFloat(val, column.float_values[row]);
+					break;
+				case FIELDDESC::CPPTYPE_DOUBLE:
+					ok = detail::ToDouble(val, column.double_values[row]);
+					break;
+				case FIELDDESC::CPPTYPE_BOOL: {
+					std::transform(val.begin(), val.end(), val.begin(), ::tolower);
+					column.bool_values[row] = (val == "true" || val == "1") ? 1 : 0;
+					ok = true;
+				} break;
+				case FIELDDESC::CPPTYPE_STRING: {
+					// The current row is always the last one; replace its text.
+					size_t begin = static_cast<size_t>(column.offsets[row]);
+					if (entry.type == FIELDDESC::TYPE_BYTES && detail::HasBytesPrefix(val)) {
+						size_t old_end = column.data.size();
+						if (!detail::AppendDecodedBytes(val.data(), val.size(), column.data)) {
+							break;
+						}
+						column.data.erase(begin, old_end - begin);
+					}
+					else {
+						column.data.resize(begin);
+						column.data.append(val);
+					}
+					column.offsets[row + 1] = column.data.size();
+					ok = true;
+				} break;
+				default: break;
+				}
+
+				if (ok) {
+					column.validity[row >> 6] |= static_cast<uint64_t>(1) << (row & 63);
+				}
+				return ok;
+			}
+
+			std::vector<Node> nodes_;
+			std::vector<Column> columns_;
+			size_t rows_;
+			bool force_lowercase_;
+			ParserContext ctx_;
+		};
+#pragma endregion
 	}
 }
 
@@ -940,5 +4979,10 @@ namespace aws {
 #undef DESCRIPTOR
 #undef REFLECTION
 #undef FIELDDESC
+#undef ENUMDESC
+#undef ENUMVALUEDESC
+#undef ONEOFDESC
+#undef AWS_PROTOPARSER_X86
+#undef AWS_PROTOPARSER_TARGET_AVX2
 
 #endif // _AWS_PROTOPARSER_HPP_
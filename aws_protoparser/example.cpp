@@ -1,4 +1,5 @@
 #include <ConfigProtoV2.pb.h>
+#include <ConfigProtoV3.pb.h>
 
 #include <aws_protoparser.hpp>
 
@@ -23,10 +24,20 @@ int main(int argc, char **argv) {
 
 	printf("%s\n", dump.c_str());
 
+	printf("json: %s\n", aws::protocolparser::Dump(cfg2, aws::protocolparser::DUMP_JSON).c_str());
+	printf("logfmt: %s\n", aws::protocolparser::Dump(cfg2, aws::protocolparser::DUMP_LOGFMT).c_str());
+	printf("argv:\n%s\n", aws::protocolparser::Dump(cfg2, aws::protocolparser::DUMP_ARGV).c_str());
+
 	int32_t enum_value = aws::protocolparser::GetEnum(&cfg2, "EnumTest", 0);
 	printf("enum_value: %i (%s)\n", enum_value,
 		aws::protocolparser::GetEnumAlias(&cfg2, "EnumTest", enum_value).c_str()
 	);
 
+	// The same arguments against the proto3 schema.
+	ConfigV3 cfg3;
+	aws::protocolparser::Parse(argc, argv, &cfg3, true);
+	printf("\nproto3 json: %s\n", aws::protocolparser::Dump(cfg3, aws::protocolparser::DUMP_JSON).c_str());
+	printf("OptionalTest given: %s\n", cfg3.has_optionaltest() ? "yes" : "no");
+
 	return 0;
 }
\ No newline at end of file
@@ -0,0 +1,755 @@
+/* Differential fuzz target for the parse paths.
+ *
+ * Each input is decoded into a schema choice and a list of 'key=value'
+ * arguments, written both as argv and as a ParseBuffer buffer.  Parse
+ * (argv and vector), ParseBuffer, LazyConfig (Materialize and getters),
+ * ParseCached (miss, then hit) and ColumnarSink must all agree with Parse;
+ * messages are compared byte for byte (deterministic serialization).  Any
+ * difference is printed and aborts.  Heap allocations per path are counted
+ * and reported as the run goes.
+ *
+ * Schemas: ConfigV2, ConfigV3 and two synthetic schemas (proto2 and proto3)
+ * built at startup with BuildDynamicSchema (tests/test_common.hpp).
+ *
+ * Built with clang it is a libFuzzer target; otherwise (or with
+ * AWS_PROTOPARSER_FUZZ_STANDALONE) a small driver runs the files given on
+ * the command line, or random inputs: fuzz_parse [-runs=N] [-seed=N] [file...]
+ */
+
+#include <ConfigProtoV2.pb.h>
+#include <ConfigProtoV3.pb.h>
+
+#include <aws_protoparser.hpp>
+
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/io/zero_copy_stream_impl_lite.h>
+
+#include <dirent.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <new>
+#include <random>
+#include <sstream>
+#include <vector>
+
+#include "../tests/test_common.hpp"
+
+namespace pb = ::google::protobuf;
+namespace pp = aws::protocolparser;
+
+#pragma region Allocation counting
+// Counted through operator new (malloc and free are left to the sanitizers).
+static unsigned long long g_allocs = 0;
+
+void *operator new(size_t n) {
+	g_allocs++;
+	void *p = malloc(n == 0 ? 1 : n);
+	if (p == nullptr) {
+		throw std::bad_alloc();
+	}
+	return p;
+}
+void *operator new[](size_t n) {
+	return operator new(n);
+}
+void operator delete(void *p) noexcept {
+	free(p);
+}
+void operator delete[](void *p) noexcept {
+	free(p);
+}
+void operator delete(void *p, size_t) noexcept {
+	free(p);
+}
+void operator delete[](void *p, size_t) noexcept {
+	free(p);
+}
+
+enum FuzzPath {
+	PATH_ARGV,
+	PATH_VECTOR,
+	PATH_BUFFER,
+	PATH_LAZY,
+	PATH_CACHED,
+	PATH_COLUMNAR,
+	PATH_COUNT
+};
+
+static const char *const g_path_names[PATH_COUNT] = {
+	"argv", "vector", "buffer", "lazy", "cached", "columnar"
+};
+
+static unsigned long long g_path_allocs[PATH_COUNT];
+static unsigned long long g_runs = 0;
+
+static void Report(FILE *out) {
+	fprintf(out, "fuzz_parse: %llu runs; allocations per run:", g_runs);
+	for (int i = 0; i < PATH_COUNT; i++) {
+		fprintf(out, " %s %.1f", g_path_names[i],
+			g_runs == 0 ? 0.0 : static_cast<double>(g_path_allocs[i]) / static_cast<double>(g_runs));
+	}
+	fprintf(out, "\n");
+}
+#pragma endregion
+
+#pragma region Schemas
+struct Schema {
+	const pb::Message *prototype;
+	pb::MessageFactory *factory;
+
+	// Parsed once from fixed arguments; every path starts from a copy.
+	pb::Message *prefilled;
+};
+
+static const char *const g_proto2_schema =
+	"name: 'fuzz_proto2.proto' package: 'fuzz' syntax: 'proto2' "
+	"enum_type { name: 'Color' options { allow_alias: true } "
+	"  value { name: 'RED' number: 0 } value { name: 'GREEN' number: 1 } "
+	"  value { name: 'ALIAS' number: 1 } value { name: 'NEG' number: -5 } } "
+	"message_type { name: 'Leaf' "
+	"  field { name: 'Text' number: 1 label: LABEL_OPTIONAL type: TYPE_STRING } "
+	"  field { name: 'Num' number: 2 label: LABEL_OPTIONAL type: TYPE_SINT64 } "
+	"  field { name: 'Color' number: 3 label: LABEL_OPTIONAL type: TYPE_ENUM type_name: '.fuzz.Color' } } "
+	"message_type { name: 'Synth' "
+	"  field { name: 'I32' number: 1 label: LABEL_OPTIONAL type: TYPE_INT32 } "
+	"  field { name: 'I64' number: 2 label: LABEL_OPTIONAL type: TYPE_INT64 } "
+	"  field { name: 'U32' number: 3 label: LABEL_OPTIONAL type: TYPE_UINT32 } "
+	"  field { name: 'U64' number: 4 label: LABEL_OPTIONAL type: TYPE_UINT64 } "
+	"  field { name: 'S32' number: 5 label: LABEL_OPTIONAL type: TYPE_SINT32 } "
+	"  field { name: 'S64' number: 6 label: LABEL_OPTIONAL type: TYPE_SINT64 } "
+	"  field { name: 'F32' number: 7 label: LABEL_OPTIONAL type: TYPE_FIXED32 } "
+	"  field { name: 'F64' number: 8 label: LABEL_OPTIONAL type: TYPE_FIXED64 } "
+	"  field { name: 'SF32' number: 9 label: LABEL_OPTIONAL type: TYPE_SFIXED32 } "
+	"  field { name: 'SF64' number: 10 label: LABEL_OPTIONAL type: TYPE_SFIXED64 } "
+	"  field { name: 'Flt' number: 11 label: LABEL_OPTIONAL type: TYPE_FLOAT } "
+	"  field { name: 'Dbl' number: 12 label: LABEL_OPTIONAL type: TYPE_DOUBLE } "
+	"  field { name: 'Bool' number: 13 label: LABEL_OPTIONAL type: TYPE_BOOL } "
+	"  field { name: 'Str' number: 14 label: LABEL_OPTIONAL type: TYPE_STRING } "
+	"  field { name: 'Raw' number: 15 label: LABEL_OPTIONAL type: TYPE_BYTES } "
+	"  field { name: 'Color' number: 16 label: LABEL_OPTIONAL type: TYPE_ENUM type_name: '.fuzz.Color' } "
+	"  field { name: 'Child' number: 17 label: LABEL_OPTIONAL type: TYPE_MESSAGE type_name: '.fuzz.Synth' } "
+	"  field { name: 'Leaf' number: 18 label: LABEL_OPTIONAL type: TYPE_MESSAGE type_name: '.fuzz.Leaf' } "
+	"  field { name: 'Tags' number: 19 label: LABEL_REPEATED type: TYPE_STRING } "
+	"  field { name: 'OName' number: 20 label: LABEL_OPTIONAL type: TYPE_STRING oneof_index: 0 } "
+	"  field { name: 'OLeaf' number: 21 label: LABEL_OPTIONAL type: TYPE_MESSAGE type_name: '.fuzz.Leaf' oneof_index: 0 } "
+	"  field { name: 'ONum' number: 22 label: LABEL_OPTIONAL type: TYPE_INT32 oneof_index: 0 } "
+	"  oneof_decl { name: 'Choice' } "
+	"  extension_range { start: 100 end: 200 } } "
+	"extension { name: 'ExtNum' number: 100 label: LABEL_OPTIONAL extendee: '.fuzz.Synth' type: TYPE_UINT32 } "
+	"extension { name: 'ExtLeaf' number: 101 label: LABEL_OPTIONAL extendee: '.fuzz.Synth' "
+	"  type: TYPE_MESSAGE type_name: '.fuzz.Leaf' }";
+
+static const char *const g_proto3_schema =
+	"name: 'fuzz_proto3.proto' package: 'fuzz3' syntax: 'proto3' "
+	"enum_type { name: 'Mode' value { name: 'ZERO' number: 0 } value { name: 'ONE' number: 1 } } "
+	"message_type { name: 'Sub3' "
+	"  field { name: 'I32' number: 1 label: LABEL_OPTIONAL type: TYPE_INT32 } "
+	"  field { name: 'Str' number: 2 label: LABEL_OPTIONAL type: TYPE_STRING } "
+	"  field { name: 'Mode' number: 3 label: LABEL_OPTIONAL type: TYPE_ENUM type_name: '.fuzz3.Mode' } } "
+	"message_type { name: 'Synth3' "
+	"  field { name: 'I64' number: 1 label: LABEL_OPTIONAL type: TYPE_INT64 } "
+	"  field { name: 'U32' number: 2 label: LABEL_OPTIONAL type: TYPE_UINT32 } "
+	"  field { name: 'Flt' number: 3 label: LABEL_OPTIONAL type: TYPE_FLOAT } "
+	"  field { name: 'Dbl' number: 4 label: LABEL_OPTIONAL type: TYPE_DOUBLE } "
+	"  field { name: 'Bool' number: 5 label: LABEL_OPTIONAL type: TYPE_BOOL } "
+	"  field { name: 'Str' number: 6 label: LABEL_OPTIONAL type: TYPE_STRING } "
+	"  field { name: 'Raw' number: 7 label: LABEL_OPTIONAL type: TYPE_BYTES } "
+	"  field { name: 'Mode' number: 8 label: LABEL_OPTIONAL type: TYPE_ENUM type_name: '.fuzz3.Mode' } "
+	"  field { name: 'Sub' number: 9 label: LABEL_OPTIONAL type: TYPE_MESSAGE type_name: '.fuzz3.Sub3' } "
+	"  field { name: 'Opt' number: 10 label: LABEL_OPTIONAL type: TYPE_INT32 oneof_index: 1 proto3_optional: true } "
+	"  field { name: 'OStr' number: 11 label: LABEL_OPTIONAL type: TYPE_STRING oneof_index: 0 } "
+	"  field { name: 'OSub' number: 12 label: LABEL_OPTIONAL type: TYPE_MESSAGE type_name: '.fuzz3.Sub3' oneof_index: 0 } "
+	"  oneof_decl { name: 'Pick' } "
+	"  oneof_decl { name: '_Opt' } }";
+#pragma endregion
+
+#pragma region Input decoding
+/**
+ * @brief Reads the fuzz input byte by byte (zeros once it runs out).
+ */
+struct Input {
+	const uint8_t *data;
+	size_t left;
+
+	uint8_t Byte() {
+		if (left == 0) {
+			return 0;
+		}
+		left--;
+		return *data++;
+	}
+
+	// Up to max bytes of raw text (no NUL: argv strings cannot hold one).
+	std::string Text(size_t max) {
+		size_t len = Byte() % (max + 1);
+		std::string out;
+		for (size_t i = 0; i < len && left > 0; i++) {
+			char c = static_cast<char>(Byte());
+			out.push_back(c == '\0' ? '0' : c);
+		}
+		return out;
+	}
+
+	// Up to max characters usable in a key or a bare token.
+	std::string Word(size_t max) {
+		static const char chars[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789_.-[]";
+		size_t len = 1 + Byte() % max;
+		std::string out;
+		for (size_t i = 0; i < len; i++) {
+			out.push_back(chars[Byte() % (sizeof(chars) - 1)]);
+		}
+		return out;
+	}
+};
+
+/**
+ * @brief One argument, in argv form and in buffer form.
+ */
+struct Argument {
+	std::string argv;
+	std::string buffer;
+};
+
+static std::string Quoted(const std::string &value) {
+	std::string out = "\"";
+	for (size_t i = 0; i < value.size(); i++) {
+		if (value[i] == '"' || value[i] == '\\') {
+			out.push_back('\\');
+		}
+		out.push_back(value[i]);
+	}
+	out.push_back('"');
+	return out;
+}
+
+static std::string Pick(Input &in, const char *const *choices, size_t count) {
+	return choices[in.Byte() % count];
+}
+
+static std::string Value(Input &in, const pp::detail::FieldPlanEntry &entry, int depth);
+
+// 'key=value' pairs for a nested message, as its value text.
+static std::string NestedValue(Input &in, const pb::Descriptor *desc, int depth) {
+	const pp::detail::FieldPlan *plan = pp::detail::GetFieldPlan(desc);
+	std::string out;
+	size_t count = in.Byte() % 4;
+	for (size_t i = 0; i < count && !plan->fields.empty(); i++) {
+		const pp::detail::FieldPlanEntry &entry = plan->fields[in.Byte() % plan->fields.size()];
+		if (!out.empty()) {
+			out.push_back(' ');
+		}
+		out.append(entry.name).push_back('=');
+		out.append(Quoted(Value(in, entry, depth + 1)));
+	}
+	return out;
+}
+
+static std::string Value(Input &in, const pp::detail::FieldPlanEntry &entry, int depth) {
+	static const char *const integers[] = {
+		"0", "-0", "1", "-1", "+3", " 5", "5 ", "0x10", "1e3", "007",
+		"2147483647", "-2147483648", "2147483648", "4294967295", "4294967296",
+		"9223372036854775807", "-9223372036854775808", "9223372036854775808",
+		"18446744073709551615", "18446744073709551616", "-18446744073709551615", ""
+	};
+	static const char *const reals[] = {
+		"0", "-0", "0.1", "-2.5", "1e308", "1e309", "1e39", "3.4028235e38", "1e-320",
+		"nan", "-nan", "inf", "-Infinity", "0x1p3", ".5", "5.", "1,5", ""
+	};
+	static const char *const bools[] = { "true", "TRUE", "True", "1", "0", "false", "yes", "" };
+
+	// A quarter of the values are raw text, whatever the type.
+	if (in.Byte() % 4 == 0) {
+		return in.Text(24);
+	}
+
+	switch (entry.field->cpp_type()) {
+	case pb::FieldDescriptor::CPPTYPE_INT32:
+	case pb::FieldDescriptor::CPPTYPE_INT64:
+	case pb::FieldDescriptor::CPPTYPE_UINT32:
+	case pb::FieldDescriptor::CPPTYPE_UINT64: {
+		if (in.Byte() % 2 == 0) {
+			return Pick(in, integers, sizeof(integers) / sizeof(integers[0]));
+		}
+		int64_t v = 0;
+		for (int i = 0; i < 8; i++) {
+			v = (v << 8) | in.Byte();
+		}
+		std::ostringstream ss;
+		ss << (v >> (in.Byte() % 64));
+		return ss.str();
+	}
+	case pb::FieldDescriptor::CPPTYPE_FLOAT:
+	case pb::FieldDescriptor::CPPTYPE_DOUBLE:
+		return Pick(in, reals, sizeof(reals) / sizeof(reals[0]));
+	case pb::FieldDescriptor::CPPTYPE_BOOL:
+		return Pick(in, bools, sizeof(bools) / sizeof(bools[0]));
+	case pb::FieldDescriptor::CPPTYPE_ENUM: {
+		const pb::EnumDescriptor *desc = entry.field->enum_type();
+		uint8_t how = in.Byte();
+		if (how % 4 == 3) {
+			std::ostringstream ss;
+			ss << static_cast<int>(static_cast<int8_t>(in.Byte()));
+			return ss.str();
+		}
+		std::string name = desc->value(in.Byte() % desc->value_count())->name();
+		for (size_t i = 0; i < name.size(); i++) {
+			if (how % 4 == 1) {
+				name[i] = static_cast<char>(tolower(name[i]));
+			}
+		}
+		return name;
+	}
+	case pb::FieldDescriptor::CPPTYPE_STRING: {
+		if (entry.type != pb::FieldDescriptor::TYPE_BYTES) {
+			return in.Text(24);
+		}
+		static const char hex[] = "0123456789abcdefABCDEFg";
+		static const char b64[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/=*";
+		static const char b64_url[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_/*";
+		uint8_t kind = in.Byte();
+		std::string out = kind % 3 == 0 ? "hex:" : "base64:";
+		const char *alphabet = kind % 3 == 0 ? hex : (kind % 3 == 1 ? b64 : b64_url);
+		size_t alphabet_len = kind % 3 == 0 ? sizeof(hex) - 1 : sizeof(b64) - 1;
+		size_t len = in.Byte() % 70;
+		for (size_t i = 0; i < len; i++) {
+			// Mostly valid characters; the last few of each alphabet are not
+			// (or, for URL-safe base64, mix in the standard alphabet).
+			uint8_t b = in.Byte();
+			out.push_back(alphabet[b % (b & 0x80 ? alphabet_len : alphabet_len - 2)]);
+		}
+		if (kind & 0x80) {
+			while (out.size() % 4 != 3) {
+				out.push_back('=');
+			}
+		}
+		return out;
+	}
+	case pb::FieldDescriptor::CPPTYPE_MESSAGE:
+		if (depth >= 3) {
+			return "";
+		}
+		return NestedValue(in, entry.field->message_type(), depth);
+	default:
+		return "";
+	}
+}
+
+/**
+ * @brief Decodes the arguments of one run.
+ */
+static void Arguments(Input &in, const pp::detail::FieldPlan *plan, std::vector<Argument> &args) {
+	size_t count = in.Byte() % 24;
+	for (size_t i = 0; i < count && in.left > 0; i++) {
+		Argument arg;
+		uint8_t kind = in.Byte();
+		if (kind % 16 == 0 || plan->fields.empty()) {
+			// A bare word (no '=') or a key no field has.
+			std::string word = in.Word(12);
+			if (kind & 0x10) {
+				arg.argv = word;
+				arg.buffer = word;
+			}
+			else {
+				std::string value = in.Text(8);
+				arg.argv = "--Unknown" + word + "=" + value;
+				arg.buffer = "--Unknown" + word + "=" + Quoted(value);
+			}
+		}
+		else {
+			const pp::detail::FieldPlanEntry &entry = plan->fields[in.Byte() % plan->fields.size()];
+			std::string value = Value(in, entry, 0);
+
+			// A message value starting with a quote is taken as quoted in
+			// argv (as ArgvEmitter writes it); keep the two forms equal.
+			if (entry.type == pb::FieldDescriptor::TYPE_MESSAGE && !value.empty() && value[0] == '"') {
+				value.insert(0, " ");
+			}
+			arg.argv = "--" + entry.name + "=" + value;
+			arg.buffer = "--" + entry.name + "=" + Quoted(value);
+		}
+		args.push_back(arg);
+	}
+}
+#pragma endregion
+
+#pragma region Comparison
+static std::string Bytes(const pb::Message &msg) {
+	std::string out;
+	{
+		pb::io::StringOutputStream stream(&out);
+		pb::io::CodedOutputStream coded(&stream);
+		coded.SetSerializationDeterministic(true);
+		msg.SerializePartialToCodedStream(&coded);
+	}
+	return out;
+}
+
+static std::string g_case;
+
+static void Fail(const char *what, const std::string &expected, const std::string &actual) {
+	fprintf(stderr, "fuzz_parse: %s differs\n%s\nexpected:\n%s\nactual:\n%s\n",
+		what, g_case.c_str(), expected.c_str(), actual.c_str());
+	abort();
+}
+
+static void Same(const char *what, const pb::Message &expected, const pb::Message &actual) {
+	if (Bytes(expected) != Bytes(actual)) {
+		Fail(what, expected.DebugString(), actual.DebugString());
+	}
+}
+
+// Compares one (non-repeated) field of two messages of the same type.
+static bool SameField(const pb::Message &a, const pb::Message &b, const pb::FieldDescriptor *field,
+	pb::MessageFactory *factory) {
+
+	const pb::Reflection *ra = a.GetReflection();
+	const pb::Reflection *rb = b.GetReflection();
+	if (ra->HasField(a, field) != rb->HasField(b, field)) {
+		return false;
+	}
+	switch (field->cpp_type()) {
+	case pb::FieldDescriptor::CPPTYPE_INT32: return ra->GetInt32(a, field) == rb->GetInt32(b, field);
+	case pb::FieldDescriptor::CPPTYPE_INT64: return ra->GetInt64(a, field) == rb->GetInt64(b, field);
+	case pb::FieldDescriptor::CPPTYPE_UINT32: return ra->GetUInt32(a, field) == rb->GetUInt32(b, field);
+	case pb::FieldDescriptor::CPPTYPE_UINT64: return ra->GetUInt64(a, field) == rb->GetUInt64(b, field);
+	case pb::FieldDescriptor::CPPTYPE_BOOL: return ra->GetBool(a, field) == rb->GetBool(b, field);
+	case pb::FieldDescriptor::CPPTYPE_ENUM: return ra->GetEnumValue(a, field) == rb->GetEnumValue(b, field);
+	case pb::FieldDescriptor::CPPTYPE_STRING: return ra->GetString(a, field) == rb->GetString(b, field);
+	case pb::FieldDescriptor::CPPTYPE_FLOAT: {
+		float x = ra->GetFloat(a, field);
+		float y = rb->GetFloat(b, field);
+		return memcmp(&x, &y, sizeof(x)) == 0;
+	}
+	case pb::FieldDescriptor::CPPTYPE_DOUBLE: {
+		double x = ra->GetDouble(a, field);
+		double y = rb->GetDouble(b, field);
+		return memcmp(&x, &y, sizeof(x)) == 0;
+	}
+	case pb::FieldDescriptor::CPPTYPE_MESSAGE:
+		return Bytes(ra->GetMessage(a, field, factory)) == Bytes(rb->GetMessage(b, field, factory));
+	default:
+		return true;
+	}
+}
+
+// Checks one row of a ColumnarSink against a parsed message, walking the
+// fields in the order the sink lays its columns out.
+static void CompareRow(const pp::ColumnarSink &sink, size_t row, const pb::Message &msg,
+	pb::MessageFactory *factory, std::vector<const pb::Descriptor *> &path, size_t &column) {
+
+	const pb::Descriptor *desc = msg.GetDescriptor();
+	const pp::detail::FieldPlan *plan = pp::detail::GetFieldPlan(desc);
+	const pb::Reflection *refl = msg.GetReflection();
+	path.push_back(desc);
+
+	for (size_t i = 0; i < plan->fields.size(); i++) {
+		const pp::detail::FieldPlanEntry &entry = plan->fields[i];
+		const pb::FieldDescriptor *field = entry.field;
+		if (entry.type == pb::FieldDescriptor::TYPE_GROUP) {
+			continue;
+		}
+		if (entry.type == pb::FieldDescriptor::TYPE_MESSAGE) {
+			const pb::Descriptor *nested = field->message_type();
+			if (std::find(path.begin(), path.end(), nested) == path.end()) {
+				const pb::Message &sub = refl->HasField(msg, field) ?
+					refl->GetMessage(msg, field, factory) : *factory->GetPrototype(nested);
+				CompareRow(sink, row, sub, factory, path, column);
+			}
+			continue;
+		}
+
+		const pp::ColumnarSink::Column &col = sink.Columns()[column++];
+		if (col.field != field) {
+			Fail("column layout", field->full_name(), col.name);
+		}
+		bool has = refl->HasField(msg, field);
+		if (!col.IsValid(row)) {
+			if (has) {
+				Fail("columnar (null column)", msg.DebugString(), col.name);
+			}
+			continue;
+		}
+
+		bool same = true;
+		switch (col.cpp_type) {
+		case pb::FieldDescriptor::CPPTYPE_INT32: same = col.int32_values[row] == refl->GetInt32(msg, field); break;
+		case pb::FieldDescriptor::CPPTYPE_ENUM: same = col.int32_values[row] == refl->GetEnumValue(msg, field); break;
+		case pb::FieldDescriptor::CPPTYPE_INT64: same = col.int64_values[row] == refl->GetInt64(msg, field); break;
+		case pb::FieldDescriptor::CPPTYPE_UINT32: same = col.uint32_values[row] == refl->GetUInt32(msg, field); break;
+		case pb::FieldDescriptor::CPPTYPE_UINT64: same = col.uint64_values[row] == refl->GetUInt64(msg, field); break;
+		case pb::FieldDescriptor::CPPTYPE_BOOL: same = (col.bool_values[row] != 0) == refl->GetBool(msg, field); break;
+		case pb::FieldDescriptor::CPPTYPE_FLOAT: {
+			float v = refl->GetFloat(msg, field);
+			same = memcmp(&col.float_values[row], &v, sizeof(v)) == 0;
+		} break;
+		case pb::FieldDescriptor::CPPTYPE_DOUBLE: {
+			double v = refl->GetDouble(msg, field);
+			same = memcmp(&col.double_values[row], &v, sizeof(v)) == 0;
+		} break;
+		case pb::FieldDescriptor::CPPTYPE_STRING: {
+			size_t begin = static_cast<size_t>(col.offsets[row]);
+			size_t end = static_cast<size_t>(col.offsets[row + 1]);
+			same = col.data.compare(begin, end - begin, refl->GetString(msg, field)) == 0;
+		} break;
+		default: break;
+		}
+		if (!same) {
+			Fail("columnar (value)", msg.DebugString(), col.name);
+		}
+	}
+	path.pop_back();
+}
+#pragma endregion
+
+#pragma region Harness
+static void IgnoreLog(pb::LogLevel, const char *, int, const std::string &) {
+}
+
+struct Harness {
+	std::vector<Schema> schemas;
+	std::vector<pp::ColumnarSink *> sinks;
+	std::string cache_dir;
+
+	Harness() {
+		// Invalid UTF-8 in proto3 strings is expected; keep the output readable.
+		pb::SetLogHandler(&IgnoreLog);
+
+		const pb::Message *synth = BuildDynamicSchema(g_proto2_schema, "fuzz.Synth");
+		const pb::Message *synth3 = BuildDynamicSchema(g_proto3_schema, "fuzz3.Synth3");
+		if (synth == nullptr || synth3 == nullptr) {
+			abort();
+		}
+		const pb::Message *prototypes[] = {
+			&ConfigV2::default_instance(), &ConfigV3::default_instance(), synth, synth3
+		};
+		for (size_t i = 0; i < sizeof(prototypes) / sizeof(prototypes[0]); i++) {
+			Schema schema = { prototypes[i], prototypes[i]->GetReflection()->GetMessageFactory(), nullptr };
+			schemas.push_back(schema);
+		}
+
+		// Prefilled messages come from fixed input through Parse itself.
+		static const uint8_t seed[] = "prefill: a fixed input giving a few set fields 0123456789";
+		for (size_t i = 0; i < schemas.size(); i++) {
+			Input in = { seed, sizeof(seed) };
+			std::vector<Argument> args;
+			Arguments(in, pp::detail::GetFieldPlan(schemas[i].prototype->GetDescriptor()), args);
+			std::vector<char *> argv(1, const_cast<char *>("fuzz"));
+			for (size_t a = 0; a < args.size(); a++) {
+				argv.push_back(const_cast<char *>(args[a].argv.c_str()));
+			}
+			schemas[i].prefilled = schemas[i].prototype->New();
+			pp::Parse(static_cast<int>(argv.size()), argv.data(), schemas[i].prefilled);
+			sinks.push_back(new pp::ColumnarSink(*schemas[i].prototype, false));
+			sinks.push_back(new pp::ColumnarSink(*schemas[i].prototype, true));
+		}
+
+		char dir[] = "/tmp/aws_protoparser_fuzz.XXXXXX";
+		if (mkdtemp(dir) == nullptr) {
+			perror("fuzz_parse: mkdtemp");
+			abort();
+		}
+		cache_dir = dir;
+	}
+
+	// Keeps the cache directory from growing without bound.
+	void ClearCache() {
+		DIR *dir = opendir(cache_dir.c_str());
+		if (dir == nullptr) {
+			return;
+		}
+		while (struct dirent *entry = readdir(dir)) {
+			if (entry->d_name[0] != '.') {
+				unlink((cache_dir + "/" + entry->d_name).c_str());
+			}
+		}
+		closedir(dir);
+	}
+
+	void Run(const uint8_t *data, size_t size) {
+		Input in = { data, size };
+		uint8_t flags = in.Byte();
+		const Schema &schema = schemas[flags % schemas.size()];
+		bool force_lowercase = (flags & 0x10) != 0;
+		bool prefill = (flags & 0x20) != 0;
+		const pp::detail::FieldPlan *plan = pp::detail::GetFieldPlan(schema.prototype->GetDescriptor());
+
+		std::vector<Argument> args;
+		Arguments(in, plan, args);
+
+		std::vector<char *> argv(1, const_cast<char *>("fuzz"));
+		std::vector<std::string> vec;
+		std::string buffer;
+		g_case = "schema " + schema.prototype->GetDescriptor()->full_name() + (force_lowercase ? " (lowercase)" : "") +
+			(prefill ? " (prefilled)" : "") + "\nargv:";
+		for (size_t i = 0; i < args.size(); i++) {
+			argv.push_back(const_cast<char *>(args[i].argv.c_str()));
+			vec.push_back(args[i].argv);
+			buffer.append(i == 0 ? "" : " ").append(args[i].buffer);
+			g_case.append("\n  ").append(args[i].argv);
+		}
+		int argc = static_cast<int>(argv.size());
+		const pb::Message &start = prefill ? *schema.prefilled : *schema.prototype;
+		unsigned long long before;
+
+		// Reference: Parse over argv.
+		pb::Message *expected = start.New();
+		expected->CopyFrom(start);
+		pp::ParserContext ctx;
+		before = g_allocs;
+		pp::Parse(ctx, argc, argv.data(), expected, force_lowercase);
+		g_path_allocs[PATH_ARGV] += g_allocs - before;
+
+		pb::Message *actual = start.New();
+		actual->CopyFrom(start);
+		pp::ParserContext vec_ctx;
+		before = g_allocs;
+		pp::Parse(vec_ctx, vec, actual, force_lowercase);
+		g_path_allocs[PATH_VECTOR] += g_allocs - before;
+		Same("Parse(vector)", *expected, *actual);
+		if (ctx.unknown.size() != vec_ctx.unknown.size()) {
+			Fail("unknown arguments (vector)", "", "");
+		}
+		for (size_t i = 0; i < ctx.unknown.size(); i++) {
+			if (ctx.unknown[i].len != vec_ctx.unknown[i].len ||
+				memcmp(ctx.unknown[i].data, vec_ctx.unknown[i].data, ctx.unknown[i].len) != 0) {
+				Fail("unknown arguments (vector)", std::string(ctx.unknown[i].data, ctx.unknown[i].len),
+					std::string(vec_ctx.unknown[i].data, vec_ctx.unknown[i].len));
+			}
+		}
+
+		actual->CopyFrom(start);
+		before = g_allocs;
+		pp::ParseBuffer(buffer.data(), buffer.size(), actual, force_lowercase);
+		g_path_allocs[PATH_BUFFER] += g_allocs - before;
+		Same("ParseBuffer", *expected, *actual);
+
+		// LazyConfig: Materialize over argv and buffer, then the getters
+		// against Parse into an empty message.
+		actual->CopyFrom(start);
+		pp::LazyConfig lazy(start);
+		before = g_allocs;
+		lazy.Index(argc, argv.data(), force_lowercase);
+		lazy.Materialize(actual);
+		g_path_allocs[PATH_LAZY] += g_allocs - before;
+		Same("LazyConfig::Materialize (argv)", *expected, *actual);
+
+		actual->CopyFrom(start);
+		lazy.Index(buffer.data(), buffer.size(), force_lowercase);
+		lazy.Materialize(actual);
+		Same("LazyConfig::Materialize (buffer)", *expected, *actual);
+
+		pb::Message *from_empty = schema.prototype->New();
+		pp::Parse(argc, argv.data(), from_empty, force_lowercase);
+		lazy.Index(argc, argv.data(), force_lowercase);
+		for (size_t i = 0; i < plan->fields.size(); i++) {
+			const pp::detail::FieldPlanEntry &entry = plan->fields[i];
+			const pb::Message *fetched = lazy.Fetch(entry.name);
+			const pb::Message &compare = fetched != nullptr ? *fetched : *schema.prototype;
+			if (!SameField(*from_empty, compare, entry.field, schema.factory)) {
+				Fail("LazyConfig getter", from_empty->DebugString(), entry.name + ": " + compare.DebugString());
+			}
+		}
+
+		// ParseCached: the first call may hit (inputs repeat); the second must,
+		// unless the result cannot be read back from wire format (proto3
+		// strings holding invalid UTF-8), which always reparses.
+		actual->CopyFrom(start);
+		before = g_allocs;
+		pp::ParseCached(argc, argv.data(), actual, cache_dir, force_lowercase);
+		g_path_allocs[PATH_CACHED] += g_allocs - before;
+		Same("ParseCached (first)", *expected, *actual);
+		actual->CopyFrom(start);
+		pb::Message *reread = start.New();
+		bool loadable = reread->ParsePartialFromString(Bytes(*expected));
+		delete reread;
+		if (!pp::ParseCached(argc, argv.data(), actual, cache_dir, force_lowercase) && loadable) {
+			Fail("ParseCached (no hit)", "hit", "miss");
+		}
+		Same("ParseCached (hit)", *expected, *actual);
+
+		// ColumnarSink: argv and buffer rows against Parse into an empty message.
+		pp::ColumnarSink &sink = *sinks[(flags % schemas.size()) * 2 + (force_lowercase ? 1 : 0)];
+		sink.Clear();
+		before = g_allocs;
+		sink.Append(argc, argv.data());
+		sink.AppendBuffer(buffer.data(), buffer.size());
+		g_path_allocs[PATH_COLUMNAR] += g_allocs - before;
+		for (size_t row = 0; row < 2; row++) {
+			std::vector<const pb::Descriptor *> path;
+			size_t column = 0;
+			CompareRow(sink, row, *from_empty, schema.factory, path, column);
+		}
+
+		delete from_empty;
+		delete actual;
+		delete expected;
+
+		g_runs++;
+		if ((g_runs & 1023) == 0) {
+			ClearCache();
+		}
+		if ((g_runs & (g_runs - 1)) == 0 && g_runs >= 1024) {
+			Report(stderr);
+		}
+	}
+};
+
+static Harness &GetHarness() {
+	static Harness *harness = new Harness;
+	return *harness;
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+	GetHarness().Run(data, size);
+	return 0;
+}
+#pragma endregion
+
+#if defined(AWS_PROTOPARSER_FUZZ_STANDALONE) || !defined(__clang__)
+int main(int argc, char **argv) {
+	unsigned long long runs = 10000;
+	unsigned long seed = 1;
+	std::vector<std::string> files;
+	for (int i = 1; i < argc; i++) {
+		if (strncmp(argv[i], "-runs=", 6) == 0) {
+			runs = strtoull(argv[i] + 6, nullptr, 10);
+		}
+		else if (strncmp(argv[i], "-seed=", 6) == 0) {
+			seed = strtoul(argv[i] + 6, nullptr, 10);
+		}
+		else {
+			files.push_back(argv[i]);
+		}
+	}
+
+	Harness &harness = GetHarness();
+	if (!files.empty()) {
+		for (size_t i = 0; i < files.size(); i++) {
+			std::ifstream file(files[i].c_str(), std::ios::binary);
+			std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+			harness.Run(reinterpret_cast<const uint8_t *>(data.data()), data.size());
+		}
+	}
+	else {
+		std::mt19937 rng(static_cast<std::mt19937::result_type>(seed));
+		std::vector<uint8_t> data;
+		for (unsigned long long run = 0; run < runs; run++) {
+			data.resize(rng() % 512);
+			for (size_t i = 0; i < data.size(); i++) {
+				data[i] = static_cast<uint8_t>(rng());
+			}
+			harness.Run(data.data(), data.size());
+		}
+	}
+
+	harness.ClearCache();
+	rmdir(harness.cache_dir.c_str());
+	Report(stdout);
+	return 0;
+}
+#endif
@@ -0,0 +1,73 @@
+/* Once warm, parsing into pooled messages through a ParserContext must not
+ * touch the heap.  Values are kept short enough for the small-string buffer,
+ * and no string oneof member is set (protobuf frees those on Clear). */
+
+#include <ConfigProtoV2.pb.h>
+
+#include <aws_protoparser.hpp>
+
+#include <cstdlib>
+#include <new>
+
+#include "test_common.hpp"
+
+static long g_allocs = 0;
+
+void *operator new(size_t n) {
+	g_allocs++;
+	void *p = malloc(n == 0 ? 1 : n);
+	if (p == nullptr) {
+		throw std::bad_alloc();
+	}
+	return p;
+}
+void operator delete(void *p) noexcept {
+	free(p);
+}
+void operator delete(void *p, size_t) noexcept {
+	free(p);
+}
+
+int main() {
+	const char *argv[] = {
+		"test",
+		"--StringTest=hi",
+		"--EnumTest=running",
+		"--DoubleTest=2.5",
+		"--FloatTest=1",
+		"--Nested=Int32Test=4 StringTest=x",
+		"--BytesTest=hex:0a0b0c",
+		"--ModeName=a",
+		"--ModeLevel=3",
+		"--Unknown=1",
+	};
+	const int argc = sizeof(argv) / sizeof(argv[0]);
+	const std::string buffer =
+		"StringTest=\"a b\" DoubleTest=1.5 Nested=\"Int32Test=2\" BytesTest=base64:AQID ModeLevel=7";
+
+	aws::protocolparser::ParserContext ctx;
+	ConfigV2 prototype;
+
+	for (int round = 0; round < 8; round++) {
+		long before = g_allocs;
+
+		::google::protobuf::Message *msg = ctx.Acquire(prototype);
+		aws::protocolparser::Parse(ctx, argc, const_cast<char **>(argv), msg);
+		const std::string &value = aws::protocolparser::GetAsString(ctx, *msg, "DoubleTest");
+		CHECK(value == "2.5");
+		ctx.Release(msg);
+
+		msg = ctx.Acquire(prototype);
+		aws::protocolparser::ParseBuffer(ctx, buffer.data(), buffer.size(), msg);
+		CHECK(aws::protocolparser::GetAsString(ctx, *msg, "StringTest") == "a b");
+		ctx.Release(msg);
+
+		long allocs = g_allocs - before;
+		if (round >= 2 && allocs != 0) {
+			fprintf(stderr, "round %d: %ld allocation(s)\n", round, allocs);
+			g_test_failures++;
+		}
+	}
+
+	return TestResult("alloc_test");
+}
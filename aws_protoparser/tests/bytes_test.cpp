@@ -0,0 +1,181 @@
+/* 'hex:' and 'base64:' values decode the same on every path (byte loop,
+ * SSE2, AVX2) at every length, and malformed base64 is rejected: padding
+ * anywhere but the end or not completing the last quantum, nonzero trailing
+ * bits, and values mixing the standard and URL-safe alphabets. */
+
+#include <ConfigProtoV2.pb.h>
+
+#include <aws_protoparser.hpp>
+
+#include "test_common.hpp"
+
+static const char kStandard[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+static const char kUrlSafe[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+
+static std::string Binary(size_t n) {
+	std::string out;
+	for (size_t i = 0; i < n; i++) {
+		out.push_back(static_cast<char>(i * 37 + 251));
+	}
+	return out;
+}
+
+static std::string Hex(const std::string &data, bool upper) {
+	const char *digits = upper ? "0123456789ABCDEF" : "0123456789abcdef";
+	std::string out;
+	for (size_t i = 0; i < data.size(); i++) {
+		unsigned char c = static_cast<unsigned char>(data[i]);
+		out.push_back(digits[c >> 4]);
+		out.push_back(digits[c & 0xF]);
+	}
+	return out;
+}
+
+static std::string Base64(const std::string &data, const char *alphabet, bool pad) {
+	std::string out;
+	uint32_t bits = 0;
+	int count = 0;
+	for (size_t i = 0; i < data.size(); i++) {
+		bits = (bits << 8) | static_cast<unsigned char>(data[i]);
+		count += 8;
+		while (count >= 6) {
+			count -= 6;
+			out.push_back(alphabet[(bits >> count) & 0x3F]);
+		}
+	}
+	if (count > 0) {
+		out.push_back(alphabet[(bits << (6 - count)) & 0x3F]);
+	}
+	while (pad && out.size() % 4 != 0) {
+		out.push_back('=');
+	}
+	return out;
+}
+
+static bool Decode(const std::string &val, std::string &out) {
+	out = "kept";
+	bool ok = aws::protocolparser::detail::AppendDecodedBytes(val.data(), val.size(), out);
+	if (!ok) {
+		CHECK_EQ_STR(out, "kept");
+	}
+	out.erase(0, 4);
+	return ok;
+}
+
+// Lengths cover empty values, every tail and several SIMD blocks.
+static void CheckValid() {
+	std::string out;
+	for (size_t n = 0; n <= 100; n++) {
+		const std::string data = Binary(n);
+
+		CHECK(Decode("hex:" + Hex(data, false), out));
+		CHECK(out == data);
+		CHECK(Decode("hex:" + Hex(data, true), out));
+		CHECK(out == data);
+
+		CHECK(Decode("base64:" + Base64(data, kStandard, true), out));
+		CHECK(out == data);
+		CHECK(Decode("base64:" + Base64(data, kStandard, false), out));
+		CHECK(out == data);
+		CHECK(Decode("base64:" + Base64(data, kUrlSafe, true), out));
+		CHECK(out == data);
+		CHECK(Decode("base64:" + Base64(data, kUrlSafe, false), out));
+		CHECK(out == data);
+	}
+
+	// Each SIMD path against the byte loop, where the CPU has it.
+	const std::string data = Binary(300);
+	const std::string hex = Hex(data, false);
+	std::string scalar(data.size(), '\0');
+	CHECK(aws::protocolparser::detail::DecodeHexScalar(hex.data(), hex.size(), &scalar[0]));
+	CHECK(scalar == data);
+#if AWS_PROTOPARSER_X86
+	std::string sse2(data.size(), '\0');
+	CHECK(aws::protocolparser::detail::DecodeHexSse2(hex.data(), hex.size(), &sse2[0]));
+	CHECK(sse2 == data);
+	if (aws::protocolparser::detail::CpuHasAvx2()) {
+		std::string avx2(data.size(), '\0');
+		CHECK(aws::protocolparser::detail::DecodeHexAvx2(hex.data(), hex.size(), &avx2[0]));
+		CHECK(avx2 == data);
+	}
+
+	const std::string b64 = Base64(data.substr(0, 288), kStandard, false);
+	std::string block(24, '\0');
+	int alphabets = 0;
+	for (size_t i = 0; i + 16 <= b64.size(); i += 16) {
+		CHECK(aws::protocolparser::detail::DecodeBase64BlockSse2(b64.data() + i, &block[0], alphabets));
+		CHECK(block.compare(0, 12, data, i / 4 * 3, 12) == 0);
+	}
+	if (aws::protocolparser::detail::CpuHasAvx2()) {
+		for (size_t i = 0; i + 32 <= b64.size(); i += 32) {
+			CHECK(aws::protocolparser::detail::DecodeBase64BlockAvx2(b64.data() + i, &block[0], alphabets));
+			CHECK(block == data.substr(i / 4 * 3, 24));
+		}
+	}
+	CHECK(alphabets == aws::protocolparser::detail::BASE64_STANDARD);
+#endif
+}
+
+static void CheckMalformed() {
+	std::string out;
+
+	// Odd hex, or a bad digit in a SIMD block or the tail.
+	CHECK(!Decode("hex:abc", out));
+	for (size_t at = 0; at < 140; at += 7) {
+		std::string hex = Hex(Binary(70), false);
+		hex[at] = 'g';
+		CHECK(!Decode("hex:" + hex, out));
+	}
+
+	// Padding before the final quantum, or not completing it.
+	CHECK(!Decode("base64:QQ==QUJD", out));
+	CHECK(!Decode("base64:QUJD=QUJD", out));
+	CHECK(!Decode("base64:QQ=", out));
+	CHECK(!Decode("base64:QUI==", out));
+	CHECK(!Decode("base64:QUJD=", out));
+	CHECK(!Decode("base64:QUJD==", out));
+	CHECK(!Decode("base64:QQ===", out));
+	CHECK(!Decode("base64:=", out));
+	CHECK(Decode("base64:QQ==", out) && out == "A");
+	CHECK(Decode("base64:QUI=", out) && out == "AB");
+
+	// Nonzero bits after the last byte ('QR' would be 'A' plus four set bits).
+	CHECK(!Decode("base64:QR", out));
+	CHECK(!Decode("base64:QR==", out));
+	CHECK(!Decode("base64:QUJ", out));
+	CHECK(Decode("base64:QUI", out) && out == "AB");
+
+	// Mixed alphabets, within a block, across blocks or in the tail.
+	const std::string mixed = Base64(Binary(90), kUrlSafe, false);
+	for (size_t at = 0; at < mixed.size(); at += 5) {
+		std::string val = mixed;
+		val[at] = '-';
+		val[(at + 61) % val.size()] = '/';
+		CHECK(!Decode("base64:" + val, out));
+		val[(at + 61) % val.size()] = '_';
+		CHECK(Decode("base64:" + val, out));
+	}
+	CHECK(!Decode("base64:" + std::string(40, 'A') + "+" + std::string(22, 'A') + "_", out));
+	CHECK(!Decode("base64:-A+A", out));
+}
+
+// Parse leaves a malformed value's field unset.
+static void CheckParse() {
+	ConfigV2 msg;
+	const char *argv[] = { "test", "--BytesTest=base64:-A+A", "--StringTest=x" };
+	aws::protocolparser::Parse(3, const_cast<char **>(argv), &msg);
+	CHECK(!msg.has_bytestest());
+	CHECK_EQ_STR(msg.stringtest(), "x");
+
+	const std::string line = "BytesTest=base64:_-8= StringTest=y";
+	msg.Clear();
+	aws::protocolparser::ParseBuffer(line.data(), line.size(), &msg);
+	CHECK_EQ_STR(msg.bytestest(), "\xff\xef");
+}
+
+int main() {
+	CheckValid();
+	CheckMalformed();
+	CheckParse();
+	return TestResult("bytes_test");
+}
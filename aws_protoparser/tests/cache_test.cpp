@@ -0,0 +1,157 @@
+/* The on-disk cache must only serve entries written for the same schema,
+ * including extensions declared in other files, and for the same input:
+ * an entry found under another input's key is a miss. */
+
+#include <ConfigProtoV2.pb.h>
+
+#include <aws_protoparser.hpp>
+
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <unistd.h>
+#include <vector>
+
+#include "test_common.hpp"
+
+// Builds base.proto (message Base, extensible) and an ext.proto extending
+// it with one field of the given type.
+static const ::google::protobuf::Message *BuildBase(const char *ext_type) {
+	std::vector<std::string> files;
+	files.push_back(
+		"name: 'base.proto' "
+		"message_type { name: 'Base' "
+		"  field { name: 'Value' number: 1 label: LABEL_OPTIONAL type: TYPE_INT32 } "
+		"  extension_range { start: 100 end: 200 } }");
+	files.push_back(
+		std::string("name: 'ext.proto' dependency: 'base.proto' "
+		"extension { name: 'Ext' number: 100 label: LABEL_OPTIONAL extendee: '.Base' type: ") +
+		ext_type + " }");
+	return BuildDynamicSchema(files, "Base");
+}
+
+// Names of the entries in a cache directory.
+static std::vector<std::string> Entries(const std::string &dir) {
+	std::vector<std::string> names;
+	DIR *d = opendir(dir.c_str());
+	if (d != nullptr) {
+		while (struct dirent *entry = readdir(d)) {
+			if (entry->d_name[0] != '.') {
+				names.push_back(entry->d_name);
+			}
+		}
+		closedir(d);
+	}
+	return names;
+}
+
+static void CheckSchemas(const std::string &dir) {
+	const ::google::protobuf::Message *with_int = BuildBase("TYPE_INT32");
+	const ::google::protobuf::Message *with_int_again = BuildBase("TYPE_INT32");
+	const ::google::protobuf::Message *with_string = BuildBase("TYPE_STRING");
+	if (with_int == nullptr || with_int_again == nullptr || with_string == nullptr) {
+		return;
+	}
+
+	uint64_t int_fp = aws::protocolparser::detail::CachedMetadata<
+		aws::protocolparser::detail::SchemaFingerprint>(with_int->GetDescriptor())->value;
+	uint64_t int_again_fp = aws::protocolparser::detail::CachedMetadata<
+		aws::protocolparser::detail::SchemaFingerprint>(with_int_again->GetDescriptor())->value;
+	uint64_t string_fp = aws::protocolparser::detail::CachedMetadata<
+		aws::protocolparser::detail::SchemaFingerprint>(with_string->GetDescriptor())->value;
+	CHECK(int_fp == int_again_fp);
+	CHECK(int_fp != string_fp);
+
+	const std::string input = "Value=1 Ext=5";
+
+	::google::protobuf::Message *first = with_int->New();
+	CHECK(!aws::protocolparser::ParseBufferCached(input.data(), input.size(), first, dir));
+	::google::protobuf::Message *hit = with_int_again->New();
+	CHECK(aws::protocolparser::ParseBufferCached(input.data(), input.size(), hit, dir));
+	CHECK_EQ_STR(hit->DebugString(), first->DebugString());
+
+	// Same base file, different extension: must be parsed, not loaded.
+	::google::protobuf::Message *other = with_string->New();
+	CHECK(!aws::protocolparser::ParseBufferCached(input.data(), input.size(), other, dir));
+	CHECK_EQ_STR(aws::protocolparser::GetString(other, "[Ext]"), "5");
+
+	delete first;
+	delete hit;
+	delete other;
+}
+
+// Plants the entry written for one input under the file name of another,
+// as a key collision (or a planted file) would; it must not be served.
+static void CheckEntryIdentity(const std::string &dir) {
+	const std::string a = "StringTest=a DoubleTest=1";
+	const std::string b = "StringTest=b DoubleTest=2";
+	const std::string a_dir = dir + "/a";
+	const std::string b_dir = dir + "/b";
+	CHECK(mkdir(a_dir.c_str(), 0700) == 0);
+	CHECK(mkdir(b_dir.c_str(), 0700) == 0);
+
+	ConfigV2 msg;
+	CHECK(!aws::protocolparser::ParseBufferCached(a.data(), a.size(), &msg, a_dir));
+	msg.Clear();
+	CHECK(!aws::protocolparser::ParseBufferCached(b.data(), b.size(), &msg, b_dir));
+	std::vector<std::string> a_entries = Entries(a_dir);
+	std::vector<std::string> b_entries = Entries(b_dir);
+	CHECK(a_entries.size() == 1 && b_entries.size() == 1);
+	if (a_entries.size() != 1 || b_entries.size() != 1) {
+		return;
+	}
+
+	// Entries are private to the user.
+	struct stat st;
+	CHECK(stat((a_dir + "/" + a_entries[0]).c_str(), &st) == 0);
+	CHECK((st.st_mode & 0777) == 0600);
+
+	// a's entry, carrying b's key in its header (magic and fingerprint come first).
+	std::string a_entry;
+	std::string b_entry;
+	{
+		std::ifstream a_in((a_dir + "/" + a_entries[0]).c_str(), std::ios::binary);
+		std::ifstream b_in((b_dir + "/" + b_entries[0]).c_str(), std::ios::binary);
+		a_entry.assign((std::istreambuf_iterator<char>(a_in)), std::istreambuf_iterator<char>());
+		b_entry.assign((std::istreambuf_iterator<char>(b_in)), std::istreambuf_iterator<char>());
+	}
+	CHECK(a_entry.size() > 24 && b_entry.size() > 24);
+	if (a_entry.size() <= 24 || b_entry.size() <= 24) {
+		return;
+	}
+	a_entry.replace(16, 8, b_entry, 16, 8);
+	std::ofstream out((b_dir + "/" + b_entries[0]).c_str(), std::ios::binary | std::ios::trunc);
+	out << a_entry;
+	out.close();
+
+	msg.Clear();
+	CHECK(!aws::protocolparser::ParseBufferCached(b.data(), b.size(), &msg, b_dir));
+	CHECK_EQ_STR(msg.stringtest(), "b");
+	CHECK(msg.doubletest() == 2);
+
+	// The mismatched entry was replaced by one for b.
+	msg.Clear();
+	CHECK(aws::protocolparser::ParseBufferCached(b.data(), b.size(), &msg, b_dir));
+	CHECK_EQ_STR(msg.stringtest(), "b");
+
+	// Same input, different prior contents: a different entry.
+	msg.Clear();
+	msg.set_modename("prior");
+	CHECK(!aws::protocolparser::ParseBufferCached(b.data(), b.size(), &msg, b_dir));
+	CHECK_EQ_STR(msg.modename(), "prior");
+}
+
+int main() {
+	char dir[] = "/tmp/aws_protoparser_cache_test.XXXXXX";
+	CHECK(mkdtemp(dir) != nullptr);
+
+	CheckSchemas(dir);
+	CheckEntryIdentity(dir);
+
+	std::string cleanup = std::string("rm -rf ") + dir;
+	CHECK(system(cleanup.c_str()) == 0);
+	return TestResult("cache_test");
+}
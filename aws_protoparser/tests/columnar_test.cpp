@@ -0,0 +1,169 @@
+/* ColumnarSink lays out one column per scalar field (nested fields as dotted
+ * names) and fills typed vectors, string offsets and validity bitmaps that
+ * match Parse row by row, across several validity words and after Clear(). */
+
+#include <ConfigProtoV2.pb.h>
+
+#include <aws_protoparser.hpp>
+
+#include <sstream>
+#include <vector>
+
+#include "test_common.hpp"
+
+static const size_t kRows = 150;
+
+// Record i: every field is given on some rows only, some with bad values.
+static std::string Record(size_t i) {
+	std::ostringstream ss;
+	ss << "DoubleTest=" << i << ".5";
+	if (i % 3 != 0) {
+		ss << " StringTest=\"row " << i << "\"";
+	}
+	if (i % 2 == 0) {
+		ss << " Nested=\"Int32Test=" << i << (i % 4 == 0 ? " StringTest=n" : "") << "\"";
+	}
+	if (i % 5 == 0) {
+		ss << " EnumTest=RUNNING";
+	}
+	if (i % 7 == 0) {
+		ss << " FloatTest=bad";
+	}
+	else if (i % 7 == 1) {
+		ss << " FloatTest=-" << i;
+	}
+	if (i % 11 == 0) {
+		ss << " BytesTest=hex:00ff";
+	}
+	return ss.str();
+}
+
+// Expected validity words for a column, from the rows Parse sets it on.
+static std::vector<uint64_t> Validity(const std::vector<ConfigV2> &rows,
+	bool (*has)(const ConfigV2 &)) {
+
+	std::vector<uint64_t> words((rows.size() + 63) / 64, 0);
+	for (size_t i = 0; i < rows.size(); i++) {
+		if (has(rows[i])) {
+			words[i / 64] |= uint64_t(1) << (i % 64);
+		}
+	}
+	return words;
+}
+
+static bool HasString(const ConfigV2 &m) { return m.has_stringtest(); }
+static bool HasDouble(const ConfigV2 &m) { return m.has_doubletest(); }
+static bool HasFloat(const ConfigV2 &m) { return m.has_floattest(); }
+static bool HasEnum(const ConfigV2 &m) { return m.has_enumtest(); }
+static bool HasNestedInt(const ConfigV2 &m) { return m.nested().has_int32test(); }
+static bool HasNestedString(const ConfigV2 &m) { return m.nested().has_stringtest(); }
+static bool HasBytes(const ConfigV2 &m) { return m.has_bytestest(); }
+
+static void CheckLayout(const aws::protocolparser::ColumnarSink &sink) {
+	const char *names[] = {
+		"StringTest", "EnumTest", "DoubleTest", "FloatTest", "Nested.Int32Test",
+		"Nested.StringTest", "BytesTest", "ModeName", "ModeLevel", "[ExtensionTest]"
+	};
+	const size_t count = sizeof(names) / sizeof(names[0]);
+	CHECK(sink.Columns().size() == count);
+	for (size_t i = 0; i < count && i < sink.Columns().size(); i++) {
+		CHECK_EQ_STR(sink.Columns()[i].name, names[i]);
+	}
+	CHECK(sink.FindColumn("Nested") == nullptr);
+	CHECK(sink.FindColumn("Nested.Int32Test")->cpp_type == ::google::protobuf::FieldDescriptor::CPPTYPE_INT32);
+}
+
+// Compares every column of the sink with messages parsed from the same records.
+static void CheckRows(const aws::protocolparser::ColumnarSink &sink, const std::vector<ConfigV2> &rows) {
+	CHECK(sink.Rows() == rows.size());
+
+	const aws::protocolparser::ColumnarSink::Column *str = sink.FindColumn("StringTest");
+	const aws::protocolparser::ColumnarSink::Column *dbl = sink.FindColumn("DoubleTest");
+	const aws::protocolparser::ColumnarSink::Column *flt = sink.FindColumn("FloatTest");
+	const aws::protocolparser::ColumnarSink::Column *enm = sink.FindColumn("EnumTest");
+	const aws::protocolparser::ColumnarSink::Column *nested_int = sink.FindColumn("Nested.Int32Test");
+	const aws::protocolparser::ColumnarSink::Column *nested_str = sink.FindColumn("Nested.StringTest");
+	const aws::protocolparser::ColumnarSink::Column *bytes = sink.FindColumn("BytesTest");
+	CHECK(str && dbl && flt && enm && nested_int && nested_str && bytes);
+	if (!(str && dbl && flt && enm && nested_int && nested_str && bytes)) {
+		return;
+	}
+
+	CHECK(str->validity == Validity(rows, HasString));
+	CHECK(dbl->validity == Validity(rows, HasDouble));
+	CHECK(flt->validity == Validity(rows, HasFloat));
+	CHECK(enm->validity == Validity(rows, HasEnum));
+	CHECK(nested_int->validity == Validity(rows, HasNestedInt));
+	CHECK(nested_str->validity == Validity(rows, HasNestedString));
+	CHECK(bytes->validity == Validity(rows, HasBytes));
+
+	// One value per row in the typed vectors; offsets has one more entry.
+	CHECK(dbl->double_values.size() == rows.size());
+	CHECK(flt->float_values.size() == rows.size());
+	CHECK(enm->int32_values.size() == rows.size());
+	CHECK(nested_int->int32_values.size() == rows.size());
+	CHECK(str->offsets.size() == rows.size() + 1);
+	CHECK(bytes->offsets.size() == rows.size() + 1);
+	if (str->offsets.size() != rows.size() + 1 || bytes->offsets.size() != rows.size() + 1) {
+		return;
+	}
+	CHECK(str->offsets[0] == 0);
+	CHECK(str->offsets[rows.size()] == str->data.size());
+
+	for (size_t i = 0; i < rows.size(); i++) {
+		const ConfigV2 &row = rows[i];
+		CHECK(dbl->double_values[i] == row.doubletest());
+		if (flt->IsValid(i)) {
+			CHECK(flt->float_values[i] == row.floattest());
+		}
+		if (enm->IsValid(i)) {
+			CHECK(enm->int32_values[i] == static_cast<int32_t>(row.enumtest()));
+		}
+		if (nested_int->IsValid(i)) {
+			CHECK(nested_int->int32_values[i] == row.nested().int32test());
+		}
+
+		// Null string rows take no space.
+		CHECK(str->offsets[i] <= str->offsets[i + 1]);
+		const std::string text = str->data.substr(static_cast<size_t>(str->offsets[i]),
+			static_cast<size_t>(str->offsets[i + 1] - str->offsets[i]));
+		CHECK_EQ_STR(text, row.stringtest());
+		const std::string raw = bytes->data.substr(static_cast<size_t>(bytes->offsets[i]),
+			static_cast<size_t>(bytes->offsets[i + 1] - bytes->offsets[i]));
+		CHECK_EQ_STR(raw, row.bytestest());
+	}
+}
+
+int main() {
+	std::string records;
+	std::vector<ConfigV2> rows(kRows);
+	for (size_t i = 0; i < kRows; i++) {
+		const std::string record = Record(i);
+		records.append(record).push_back('\n');
+		aws::protocolparser::ParseBuffer(record.data(), record.size(), &rows[i]);
+	}
+
+	ConfigV2 prototype;
+	aws::protocolparser::ColumnarSink sink(prototype);
+	CheckLayout(sink);
+	sink.AppendLines(records.data(), records.size());
+	CheckRows(sink, rows);
+
+	// Clear() keeps the layout; the sink refills from row 0.
+	sink.Clear();
+	CHECK(sink.Rows() == 0);
+	CHECK(sink.FindColumn("StringTest")->data.empty());
+	const size_t refill = 70;
+	sink.AppendLines(records.data(), records.size());
+	sink.Clear();
+	size_t pos = 0;
+	for (size_t i = 0; i < refill; i++) {
+		size_t nl = records.find('\n', pos);
+		sink.AppendBuffer(records.data() + pos, nl - pos);
+		pos = nl + 1;
+	}
+	CheckLayout(sink);
+	CheckRows(sink, std::vector<ConfigV2>(rows.begin(), rows.begin() + refill));
+
+	return TestResult("columnar_test");
+}
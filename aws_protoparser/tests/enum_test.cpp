@@ -0,0 +1,100 @@
+/* GetEnumAlias returns the first name declared for a number (allow_alias),
+ * works for enums declared outside the message (top level or in another
+ * message, densely or sparsely numbered) and, once warm, never touches the
+ * heap. */
+
+#include <ConfigProtoV2.pb.h>
+
+#include <aws_protoparser.hpp>
+
+#include <cstdlib>
+#include <new>
+
+#include "test_common.hpp"
+
+static long g_allocs = 0;
+
+void *operator new(size_t n) {
+	g_allocs++;
+	void *p = malloc(n == 0 ? 1 : n);
+	if (p == nullptr) {
+		throw std::bad_alloc();
+	}
+	return p;
+}
+void operator delete(void *p) noexcept {
+	free(p);
+}
+void operator delete(void *p, size_t) noexcept {
+	free(p);
+}
+
+int main() {
+	const ::google::protobuf::Message *prototype = BuildDynamicSchema(
+		"name: 'enum_test.proto' package: 'enums' "
+		"enum_type { name: 'Color' options { allow_alias: true } "
+		"  value { name: 'RED' number: 0 } value { name: 'GREEN' number: 1 } "
+		"  value { name: 'LIME' number: 1 } value { name: 'DARK' number: -2 } } "
+		"enum_type { name: 'Sparse' "
+		"  value { name: 'NONE' number: 0 } value { name: 'FAR' number: 1000000 } "
+		"  value { name: 'NEAR' number: -1000000 } } "
+		"message_type { name: 'Holder' "
+		"  enum_type { name: 'Level' value { name: 'LOW' number: 0 } value { name: 'HIGH' number: 5 } } } "
+		"message_type { name: 'Uses' "
+		"  field { name: 'Color' number: 1 label: LABEL_OPTIONAL type: TYPE_ENUM type_name: '.enums.Color' } "
+		"  field { name: 'Sparse' number: 2 label: LABEL_OPTIONAL type: TYPE_ENUM type_name: '.enums.Sparse' } "
+		"  field { name: 'Level' number: 3 label: LABEL_OPTIONAL type: TYPE_ENUM type_name: '.enums.Holder.Level' } }",
+		"enums.Uses");
+	if (prototype == nullptr) {
+		return TestResult("enum_test");
+	}
+
+	// Aliases parse to their number; the first name declared is returned.
+	::google::protobuf::Message *msg = prototype->New();
+	const char *argv[] = { "test", "--Color=LIME", "--Sparse=NEAR", "--Level=HIGH" };
+	aws::protocolparser::Parse(4, const_cast<char **>(argv), msg);
+	CHECK(aws::protocolparser::GetEnum(msg, "Color") == 1);
+	CHECK_EQ_STR(aws::protocolparser::GetEnumAlias(msg, "Color", 1), "GREEN");
+	CHECK_EQ_STR(aws::protocolparser::GetEnumAlias(msg, "Color", -2), "DARK");
+	CHECK_EQ_STR(aws::protocolparser::GetEnumAlias(msg, "Color", 2), "");
+
+	// Sparse numbering takes the descriptor's own lookup.
+	CHECK(aws::protocolparser::GetEnum(msg, "Sparse") == -1000000);
+	CHECK_EQ_STR(aws::protocolparser::GetEnumAlias(msg, "Sparse", 1000000), "FAR");
+	CHECK_EQ_STR(aws::protocolparser::GetEnumAlias(msg, "Sparse", 5), "");
+
+	// Declared in another message.
+	CHECK(aws::protocolparser::GetEnum(msg, "Level") == 5);
+	CHECK_EQ_STR(aws::protocolparser::GetEnumAlias(msg, "Level", 5), "HIGH");
+
+	// Not an enum field, or no such field.
+	CHECK_EQ_STR(aws::protocolparser::GetEnumAlias(msg, "Missing", 0), "");
+
+	// ConfigV2's nested enum: STARTED and RUNNING are both 1.
+	ConfigV2 config;
+	const char *config_argv[] = { "test", "--EnumTest=RUNNING" };
+	aws::protocolparser::Parse(2, const_cast<char **>(config_argv), &config);
+	CHECK(config.enumtest() == ConfigV2::STARTED);
+	CHECK_EQ_STR(aws::protocolparser::GetEnumAlias(&config, "EnumTest", config.enumtest()), "STARTED");
+
+	// Warm: no allocation for any lookup (field names fit the small-string buffer).
+	const std::string color = "Color";
+	const std::string sparse = "Sparse";
+	const std::string level = "Level";
+	const std::string enum_test = "EnumTest";
+	const ::google::protobuf::FieldDescriptor *color_field = msg->GetDescriptor()->FindFieldByName("Color");
+	size_t total = 0;
+	long before = g_allocs;
+	for (int i = 0; i < 1000; i++) {
+		total += aws::protocolparser::GetEnumAlias(msg, color, i % 3 - 1).size();
+		total += aws::protocolparser::GetEnumAlias(msg, sparse, i % 2 == 0 ? 1000000 : 7).size();
+		total += aws::protocolparser::GetEnumAlias(msg, level, 5).size();
+		total += aws::protocolparser::GetEnumAlias(&config, enum_test, 1).size();
+		total += aws::protocolparser::GetEnumAlias(color_field, -2).size();
+	}
+	CHECK(g_allocs == before);
+	CHECK(total > 0);
+
+	delete msg;
+	return TestResult("enum_test");
+}
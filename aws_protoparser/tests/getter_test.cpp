@@ -0,0 +1,49 @@
+/* The pre-1.2.0 GetFloat(double) and GetUInt32(int32_t) overloads keep their
+ * old behaviour: double fields only, and sint32/sfixed32 fields only. */
+
+#include <aws_protoparser.hpp>
+
+#include "test_common.hpp"
+
+int main() {
+	const ::google::protobuf::Message *prototype = BuildDynamicSchema(
+		"name: 'getter_test.proto' "
+		"message_type { name: 'Getters' "
+		"  field { name: 'Flt' number: 1 label: LABEL_OPTIONAL type: TYPE_FLOAT } "
+		"  field { name: 'Dbl' number: 2 label: LABEL_OPTIONAL type: TYPE_DOUBLE } "
+		"  field { name: 'I32' number: 3 label: LABEL_OPTIONAL type: TYPE_INT32 } "
+		"  field { name: 'S32' number: 4 label: LABEL_OPTIONAL type: TYPE_SINT32 } "
+		"  field { name: 'SF32' number: 5 label: LABEL_OPTIONAL type: TYPE_SFIXED32 } "
+		"  field { name: 'U32' number: 6 label: LABEL_OPTIONAL type: TYPE_UINT32 } }",
+		"Getters");
+	if (prototype == nullptr) {
+		return TestResult("getter_test");
+	}
+
+	::google::protobuf::Message *msg = prototype->New();
+	const char *argv[] = { "test", "--Flt=1.5", "--Dbl=2.5", "--I32=-3", "--S32=-4", "--SF32=-5", "--U32=6" };
+	aws::protocolparser::Parse(7, const_cast<char **>(argv), msg);
+
+	// GetFloat(double): the old spelling of GetDouble.
+	CHECK(aws::protocolparser::GetFloat(msg, "Dbl", 0.0) == 2.5);
+	CHECK(aws::protocolparser::GetFloat(msg, "Flt", 0.0) == 0.0);
+	CHECK(aws::protocolparser::GetFloat(msg, "Flt", 0.0f) == 1.5f);
+
+	// GetUInt32(int32_t): sint32 and sfixed32, nothing else.
+	CHECK(aws::protocolparser::GetUInt32(msg, "S32", int32_t(0)) == -4);
+	CHECK(aws::protocolparser::GetUInt32(msg, "SF32", int32_t(0)) == -5);
+	CHECK(aws::protocolparser::GetUInt32(msg, "I32", int32_t(0)) == 0);
+	CHECK(aws::protocolparser::GetUInt32(msg, "U32", int32_t(0)) == 0);
+	CHECK(aws::protocolparser::GetUInt32(msg, "U32", uint32_t(0)) == 6u);
+
+	// set_if_missing stores the default into an unset field of the right type.
+	msg->Clear();
+	CHECK(aws::protocolparser::GetFloat(msg, "Dbl", 7.5, true) == 7.5);
+	CHECK(aws::protocolparser::GetFloat(msg, "Dbl", 0.0) == 7.5);
+	CHECK(aws::protocolparser::GetUInt32(msg, "S32", int32_t(9), true) == 9);
+	CHECK(aws::protocolparser::GetUInt32(msg, "I32", int32_t(9), true) == 0);
+	CHECK(aws::protocolparser::GetInt32(msg, "I32") == 0);
+
+	delete msg;
+	return TestResult("getter_test");
+}
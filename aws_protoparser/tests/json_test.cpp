@@ -0,0 +1,75 @@
+/* DUMP_JSON output must be valid JSON in protobuf's mapping: protobuf's own
+ * JSON parser reads it back to the same message (bytes as base64, 64-bit
+ * integers as strings). */
+
+#include <ConfigProtoV2.pb.h>
+
+#include <aws_protoparser.hpp>
+
+#include <google/protobuf/text_format.h>
+#include <google/protobuf/util/json_util.h>
+
+#include "test_common.hpp"
+
+static void CheckReadBack(const ::google::protobuf::Message &original) {
+	const std::string json = aws::protocolparser::Dump(original, aws::protocolparser::DUMP_JSON);
+
+	::google::protobuf::Message *back = original.New();
+	CHECK(::google::protobuf::util::JsonStringToMessage(json, back).ok());
+	CHECK_EQ_STR(back->DebugString(), original.DebugString());
+	delete back;
+}
+
+static void CheckConfig() {
+	ConfigV2 msg;
+	msg.set_stringtest("quote \" backslash \\ newline \n");
+	msg.set_doubletest(-2.5);
+	msg.set_bytestest(std::string("\0\xff\n\x80", 4));
+	msg.mutable_nested()->set_int32test(-7);
+	msg.set_modelevel(3);
+
+	const std::string json = aws::protocolparser::Dump(msg, aws::protocolparser::DUMP_JSON);
+	CHECK(json.find("\"BytesTest\":\"AP8KgA==\"") != std::string::npos);
+	CheckReadBack(msg);
+
+	// Every padding length.
+	const char *encoded[] = { "", "YQ==", "YWI=", "YWJj" };
+	for (int n = 0; n < 4; n++) {
+		msg.set_bytestest(std::string("abc", static_cast<size_t>(n)));
+		const std::string expected = std::string("\"BytesTest\":\"") + encoded[n] + "\"";
+		CHECK(aws::protocolparser::Dump(msg, aws::protocolparser::DUMP_JSON).find(expected) != std::string::npos);
+		CheckReadBack(msg);
+	}
+}
+
+static void CheckInt64() {
+	const ::google::protobuf::Message *wide = BuildDynamicSchema(
+		"name: 'json_test.proto' "
+		"message_type { name: 'Wide' "
+		"  field { name: 'I64' number: 1 label: LABEL_OPTIONAL type: TYPE_INT64 } "
+		"  field { name: 'U64' number: 2 label: LABEL_OPTIONAL type: TYPE_UINT64 } "
+		"  field { name: 'S64' number: 3 label: LABEL_OPTIONAL type: TYPE_SINT64 } "
+		"  field { name: 'F64' number: 4 label: LABEL_OPTIONAL type: TYPE_FIXED64 } "
+		"  field { name: 'SF64' number: 5 label: LABEL_OPTIONAL type: TYPE_SFIXED64 } }",
+		"Wide");
+	if (wide == nullptr) {
+		return;
+	}
+
+	::google::protobuf::Message *msg = wide->New();
+	CHECK(::google::protobuf::TextFormat::ParseFromString(
+		"I64: -9007199254740993 U64: 18446744073709551615 S64: 9007199254740993 "
+		"F64: 1 SF64: -1", msg));
+
+	const std::string json = aws::protocolparser::Dump(*msg, aws::protocolparser::DUMP_JSON);
+	CHECK(json.find("\"I64\":\"-9007199254740993\"") != std::string::npos);
+	CHECK(json.find("\"U64\":\"18446744073709551615\"") != std::string::npos);
+	CheckReadBack(*msg);
+	delete msg;
+}
+
+int main() {
+	CheckConfig();
+	CheckInt64();
+	return TestResult("json_test");
+}
@@ -0,0 +1,93 @@
+/* LazyConfig must agree with Parse: Materialize() gives the same message and
+ * each getter the same value, including repeated keys (nested values merge,
+ * malformed later values do not hide earlier ones) and oneofs. */
+
+#include <ConfigProtoV2.pb.h>
+
+#include <aws_protoparser.hpp>
+
+#include <vector>
+
+#include "test_common.hpp"
+
+// Compares Materialize() with Parse for argv (without argv[0]) and for the
+// same arguments as a buffer, both into a prefilled message.
+static void CheckMaterialize(const std::vector<const char *> &args) {
+	std::vector<char *> argv(1, const_cast<char *>("test"));
+	std::string buffer;
+	for (size_t i = 0; i < args.size(); i++) {
+		argv.push_back(const_cast<char *>(args[i]));
+		buffer.append(buffer.empty() ? "" : " ").append(args[i]);
+	}
+	int argc = static_cast<int>(argv.size());
+
+	ConfigV2 prefilled;
+	prefilled.set_stringtest("kept");
+	prefilled.mutable_nested()->set_int32test(9);
+
+	ConfigV2 parsed = prefilled;
+	aws::protocolparser::Parse(argc, argv.data(), &parsed);
+
+	ConfigV2 lazy = prefilled;
+	aws::protocolparser::LazyConfig cfg(lazy);
+	cfg.Index(argc, argv.data());
+	CHECK(cfg.Materialize(&lazy));
+	CHECK_EQ_STR(lazy.DebugString(), parsed.DebugString());
+
+	ConfigV2 from_buffer = prefilled;
+	cfg.Index(buffer.data(), buffer.size());
+	CHECK(cfg.Materialize(&from_buffer));
+	CHECK_EQ_STR(from_buffer.DebugString(), parsed.DebugString());
+}
+
+static void CheckRepeatedKeys() {
+	const char *argv[] = {
+		"test",
+		"--Nested=Int32Test=1",
+		"--Nested=StringTest=y",
+		"--DoubleTest=5",
+		"--DoubleTest=abc",
+		"--FloatTest=x",
+	};
+	aws::protocolparser::LazyConfig cfg((ConfigV2()));
+	cfg.Index(6, const_cast<char **>(argv));
+
+	CHECK(aws::protocolparser::GetDouble(&cfg, "DoubleTest", -1.0) == 5.0);
+	CHECK(cfg.Has("FloatTest"));
+	CHECK(aws::protocolparser::GetFloat(&cfg, "FloatTest", -1.0f) == -1.0f);
+
+	const ::google::protobuf::Message *msg = cfg.Fetch("Nested");
+	CHECK(msg != nullptr);
+	if (msg != nullptr) {
+		const ConfigV2_Nested &nested = static_cast<const ConfigV2 *>(msg)->nested();
+		CHECK(nested.int32test() == 1);
+		CHECK_EQ_STR(nested.stringtest(), "y");
+	}
+
+	std::vector<const char *> args(argv + 1, argv + 6);
+	CheckMaterialize(args);
+}
+
+static void CheckOneof() {
+	const char *argv[] = { "test", "--ModeName=a", "--ModeLevel=zz" };
+	aws::protocolparser::LazyConfig cfg((ConfigV2()));
+	cfg.Index(3, const_cast<char **>(argv));
+	CHECK_EQ_STR(aws::protocolparser::GetString(&cfg, "ModeName", "none"), "a");
+	CHECK(aws::protocolparser::GetInt32(&cfg, "ModeLevel", -1) == -1);
+
+	const char *argv_level[] = { "test", "--ModeLevel=zz", "--ModeName=a", "--ModeLevel=4" };
+	cfg.Index(4, const_cast<char **>(argv_level));
+	CHECK(aws::protocolparser::GetInt32(&cfg, "ModeLevel", -1) == 4);
+	CHECK_EQ_STR(aws::protocolparser::GetString(&cfg, "ModeName", "none"), "none");
+
+	std::vector<const char *> args(argv + 1, argv + 3);
+	CheckMaterialize(args);
+	args.assign(argv_level + 1, argv_level + 4);
+	CheckMaterialize(args);
+}
+
+int main() {
+	CheckRepeatedKeys();
+	CheckOneof();
+	return TestResult("lazy_test");
+}
@@ -0,0 +1,61 @@
+/* Within a oneof the last member given a well-formed value wins; a later
+ * member whose value does not convert must not clear an earlier valid one. */
+
+#include <ConfigProtoV2.pb.h>
+
+#include <aws_protoparser.hpp>
+
+#include "test_common.hpp"
+
+static void CheckArgv() {
+	const char *argv[] = { "test", "--ModeName=a", "--ModeLevel=zz" };
+	ConfigV2 msg;
+	aws::protocolparser::Parse(3, const_cast<char **>(argv), &msg);
+	CHECK_EQ_STR(aws::protocolparser::GetOneofCase(msg, "Mode"), "ModeName");
+	CHECK_EQ_STR(msg.modename(), "a");
+
+	const char *argv_level[] = { "test", "--ModeName=a", "--ModeLevel=4" };
+	msg.Clear();
+	aws::protocolparser::Parse(3, const_cast<char **>(argv_level), &msg);
+	CHECK_EQ_STR(aws::protocolparser::GetOneofCase(msg, "Mode"), "ModeLevel");
+	CHECK(msg.modelevel() == 4);
+}
+
+static void CheckBuffer() {
+	const std::string buffer = "ModeLevel=3 ModeName=b ModeLevel=x";
+	ConfigV2 msg;
+	aws::protocolparser::ParseBuffer(buffer.data(), buffer.size(), &msg);
+	CHECK_EQ_STR(aws::protocolparser::GetOneofCase(msg, "Mode"), "ModeName");
+	CHECK_EQ_STR(msg.modename(), "b");
+
+	// Nothing converts: the oneof is left alone.
+	const std::string invalid = "ModeLevel=x ModeLevel=y";
+	msg.Clear();
+	msg.set_modename("kept");
+	aws::protocolparser::ParseBuffer(invalid.data(), invalid.size(), &msg);
+	CHECK_EQ_STR(msg.modename(), "kept");
+}
+
+static void CheckColumnar() {
+	ConfigV2 prototype;
+	aws::protocolparser::ColumnarSink sink(prototype);
+	const std::string records = "ModeName=a ModeLevel=zz\nModeName=a ModeLevel=5\n";
+	sink.AppendLines(records.data(), records.size());
+	CHECK(sink.Rows() == 2);
+
+	const aws::protocolparser::ColumnarSink::Column *name = sink.FindColumn("ModeName");
+	const aws::protocolparser::ColumnarSink::Column *level = sink.FindColumn("ModeLevel");
+	CHECK(name != nullptr && level != nullptr);
+	if (name != nullptr && level != nullptr) {
+		CHECK(name->IsValid(0) && !level->IsValid(0));
+		CHECK(!name->IsValid(1) && level->IsValid(1));
+		CHECK(level->int32_values[1] == 5);
+	}
+}
+
+int main() {
+	CheckArgv();
+	CheckBuffer();
+	CheckColumnar();
+	return TestResult("oneof_test");
+}
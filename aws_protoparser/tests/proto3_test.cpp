@@ -0,0 +1,84 @@
+/* Proto3 (ConfigV3): every parse path must leave a message exactly as Parse
+ * does, including values set back to their default on a prefilled message,
+ * explicit-presence ('optional') fields and open enums. */
+
+#include <ConfigProtoV3.pb.h>
+
+#include <aws_protoparser.hpp>
+
+#include <cstdlib>
+
+#include "test_common.hpp"
+
+static void CheckPaths(const ConfigV3 &prefilled, int argc, char **argv,
+	const std::string &cache_dir) {
+
+	ConfigV3 parsed = prefilled;
+	aws::protocolparser::Parse(argc, argv, &parsed);
+
+	std::string buffer;
+	for (int i = 1; i < argc; i++) {
+		buffer.append(i > 1 ? " " : "").append(argv[i]);
+	}
+	ConfigV3 from_buffer = prefilled;
+	aws::protocolparser::ParseBuffer(buffer.data(), buffer.size(), &from_buffer);
+	CHECK_EQ_STR(from_buffer.DebugString(), parsed.DebugString());
+
+	ConfigV3 lazy = prefilled;
+	aws::protocolparser::LazyConfig cfg(lazy);
+	cfg.Index(argc, argv);
+	CHECK(cfg.Materialize(&lazy));
+	CHECK_EQ_STR(lazy.DebugString(), parsed.DebugString());
+
+	ConfigV3 miss = prefilled;
+	CHECK(!aws::protocolparser::ParseCached(argc, argv, &miss, cache_dir));
+	CHECK_EQ_STR(miss.DebugString(), parsed.DebugString());
+
+	ConfigV3 hit = prefilled;
+	CHECK(aws::protocolparser::ParseCached(argc, argv, &hit, cache_dir));
+	CHECK_EQ_STR(hit.DebugString(), parsed.DebugString());
+}
+
+int main() {
+	char dir[] = "/tmp/aws_protoparser_proto3_test.XXXXXX";
+	CHECK(mkdtemp(dir) != nullptr);
+
+	// Set back to the default: the value must not survive.
+	const char *zero[] = { "test", "--DoubleTest=0", "--StringTest=", "--EnumTest=UNKNOWN" };
+	ConfigV3 prefilled;
+	prefilled.set_doubletest(5);
+	prefilled.set_stringtest("kept?");
+	prefilled.set_enumtest(ConfigV3::RUNNING);
+	CheckPaths(prefilled, 4, const_cast<char **>(zero), dir);
+
+	ConfigV3 parsed = prefilled;
+	aws::protocolparser::Parse(4, const_cast<char **>(zero), &parsed);
+	CHECK(parsed.doubletest() == 0.0);
+	CHECK(parsed.stringtest().empty());
+	CHECK(parsed.enumtest() == ConfigV3::UNKNOWN);
+
+	// The same input with nothing prefilled stores nothing.
+	CheckPaths(ConfigV3(), 4, const_cast<char **>(zero), dir);
+
+	// Explicit presence, open enums and nested messages.
+	const char *mixed[] = {
+		"test",
+		"--OptionalTest=0",
+		"--EnumTest=7",
+		"--Nested=\"Int32Test=0 StringTest=x\"",
+		"--ModeLevel=0",
+		"--BytesTest=hex:00ff",
+	};
+	CheckPaths(prefilled, 6, const_cast<char **>(mixed), dir);
+
+	parsed = ConfigV3();
+	aws::protocolparser::Parse(6, const_cast<char **>(mixed), &parsed);
+	CHECK(parsed.has_optionaltest() && parsed.optionaltest() == 0);
+	CHECK(parsed.enumtest() == 7);
+	CHECK(parsed.Mode_case() == ConfigV3::kModeLevel);
+	CHECK_EQ_STR(parsed.nested().stringtest(), "x");
+
+	std::string cleanup = std::string("rm -rf ") + dir;
+	CHECK(system(cleanup.c_str()) == 0);
+	return TestResult("proto3_test");
+}
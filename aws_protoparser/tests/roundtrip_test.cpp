@@ -0,0 +1,192 @@
+/* DUMP_ARGV output must parse back to the same message, both as argv (one
+ * argument per line) and as a ParseBuffer buffer; so must DUMP_LOGFMT output
+ * of messages without nested fields.  Extensions are read by either name and
+ * appear in every dump. */
+
+#include <ConfigProtoV2.pb.h>
+
+#include <aws_protoparser.hpp>
+
+#include <google/protobuf/text_format.h>
+
+#include <vector>
+
+#include "test_common.hpp"
+
+// Parses a DUMP_ARGV dump as argv and as a buffer into fresh copies of
+// prototype; both must serialize like original.
+static void CheckRoundTrip(const ::google::protobuf::Message &original) {
+	const std::string dump = aws::protocolparser::Dump(original, aws::protocolparser::DUMP_ARGV);
+
+	std::vector<std::string> lines;
+	size_t begin = 0;
+	for (size_t nl = dump.find('\n'); nl != std::string::npos; nl = dump.find('\n', begin)) {
+		lines.push_back(dump.substr(begin, nl - begin));
+		begin = nl + 1;
+	}
+	std::vector<char *> argv(1, const_cast<char *>("test"));
+	for (size_t i = 0; i < lines.size(); i++) {
+		argv.push_back(const_cast<char *>(lines[i].c_str()));
+	}
+
+	::google::protobuf::Message *from_argv = original.New();
+	aws::protocolparser::Parse(static_cast<int>(argv.size()), argv.data(), from_argv);
+	CHECK_EQ_STR(from_argv->DebugString(), original.DebugString());
+
+	::google::protobuf::Message *from_buffer = original.New();
+	aws::protocolparser::ParseBuffer(dump.data(), dump.size(), from_buffer);
+	CHECK_EQ_STR(from_buffer->DebugString(), original.DebugString());
+
+	delete from_argv;
+	delete from_buffer;
+}
+
+static void CheckConfig() {
+	ConfigV2 msg;
+	msg.set_stringtest("top");
+	msg.set_doubletest(0.1);
+	msg.mutable_nested()->set_int32test(3);
+	msg.mutable_nested()->set_stringtest("a \"b\" \\c\nd=e");
+	msg.set_modename("mode");
+	CheckRoundTrip(msg);
+
+	msg.mutable_nested()->Clear();
+	CheckRoundTrip(msg);
+}
+
+static void CheckBytes() {
+	const std::string binary("\0a\nb\"\\ \xff", 8);
+
+	ConfigV2 msg;
+	msg.set_bytestest(binary);
+	msg.mutable_nested()->set_stringtest("x");
+	CheckRoundTrip(msg);
+
+	msg.set_bytestest("");
+	CheckRoundTrip(msg);
+
+	// logfmt has no nested form ParseBuffer reads; flat messages only.
+	ConfigV2 flat;
+	flat.set_stringtest("two words");
+	flat.set_modelevel(2);
+	for (size_t n = 0; n <= binary.size(); n++) {
+		flat.set_bytestest(binary.substr(0, n));
+		const std::string logfmt = aws::protocolparser::Dump(flat, aws::protocolparser::DUMP_LOGFMT);
+		ConfigV2 back;
+		aws::protocolparser::ParseBuffer(logfmt.data(), logfmt.size(), &back);
+		CHECK_EQ_STR(back.DebugString(), flat.DebugString());
+	}
+}
+
+// Three levels of messages, so values are escaped more than once.
+static void CheckDeepNesting() {
+	const ::google::protobuf::Message *outer = BuildDynamicSchema(
+		"name: 'roundtrip_test.proto' "
+		"message_type { name: 'Inner' "
+		"  field { name: 'Text' number: 1 label: LABEL_OPTIONAL type: TYPE_STRING } "
+		"  field { name: 'Data' number: 2 label: LABEL_OPTIONAL type: TYPE_BYTES } } "
+		"message_type { name: 'Middle' "
+		"  field { name: 'Inner' number: 1 label: LABEL_OPTIONAL type: TYPE_MESSAGE type_name: '.Inner' } "
+		"  field { name: 'Text' number: 2 label: LABEL_OPTIONAL type: TYPE_STRING } } "
+		"message_type { name: 'Outer' "
+		"  field { name: 'Middle' number: 1 label: LABEL_OPTIONAL type: TYPE_MESSAGE type_name: '.Middle' } "
+		"  field { name: 'Text' number: 2 label: LABEL_OPTIONAL type: TYPE_STRING } }",
+		"Outer");
+	if (outer == nullptr) {
+		return;
+	}
+
+	::google::protobuf::Message *msg = outer->New();
+	CHECK(::google::protobuf::TextFormat::ParseFromString(
+		"Text: 'x' Middle { Text: 'two words' Inner { Text: 'say \"hi\" \\\\ \\t' Data: '\\000\\n\\377' } }", msg));
+	CheckRoundTrip(*msg);
+	delete msg;
+}
+
+// A recursive type nests as deep as its data; argv output escapes once more
+// per level, so it stops at ArgvEmitter::MaxNesting().
+static void CheckNestingLimit() {
+	const ::google::protobuf::Message *prototype = BuildDynamicSchema(
+		"name: 'roundtrip_nesting.proto' "
+		"message_type { name: 'Node' "
+		"  field { name: 'Text' number: 1 label: LABEL_OPTIONAL type: TYPE_STRING } "
+		"  field { name: 'Child' number: 2 label: LABEL_OPTIONAL type: TYPE_MESSAGE type_name: '.Node' } }",
+		"Node");
+	if (prototype == nullptr) {
+		return;
+	}
+
+	const int max = aws::protocolparser::ArgvEmitter::MaxNesting();
+	::google::protobuf::Message *msg = prototype->New();
+	::google::protobuf::Message *leaf = msg;
+	for (int level = 0; level < max; level++) {
+		const ::google::protobuf::FieldDescriptor *child = leaf->GetDescriptor()->FindFieldByName("Child");
+		leaf = leaf->GetReflection()->MutableMessage(leaf, child);
+		aws::protocolparser::SetString(leaf, "Text", "a \"b\" \\");
+	}
+
+	// At the limit: round trips; a quote in the deepest string value takes
+	// 2^(max + 1) - 1 backslashes, and no run of them reaches 3 * 2^max.
+	CheckRoundTrip(*msg);
+	const std::string dump = aws::protocolparser::Dump(*msg, aws::protocolparser::DUMP_ARGV);
+	CHECK(dump.find(std::string((2u << max) - 1, '\\') + "\"") != std::string::npos);
+	size_t longest = 0;
+	for (size_t i = 0, run = 0; i < dump.size(); i++) {
+		run = dump[i] == '\\' ? run + 1 : 0;
+		longest = run > longest ? run : longest;
+	}
+	CHECK(longest < (3u << max));
+
+	// One level deeper: refused, nothing written.
+	const ::google::protobuf::FieldDescriptor *child = leaf->GetDescriptor()->FindFieldByName("Child");
+	leaf->GetReflection()->MutableMessage(leaf, child);
+	CHECK(aws::protocolparser::Dump(*msg, aws::protocolparser::DUMP_ARGV).empty());
+	std::string out;
+	{
+		aws::protocolparser::Writer writer(&out);
+		CHECK(!aws::protocolparser::Dump(*msg, writer, aws::protocolparser::DUMP_ARGV));
+	}
+	CHECK(out.empty());
+
+	// Other formats do not escape per level and are unaffected.
+	CHECK(!aws::protocolparser::Dump(*msg, aws::protocolparser::DUMP_JSON).empty());
+	delete msg;
+}
+
+// ExtensionTest extends ConfigV2 from the same file: it is read by its own
+// name and as "[ExtensionTest]", and written in the bracketed form.
+static void CheckExtensions() {
+	const char *argv[] = { "test", "--[ExtensionTest]=5", "--StringTest=s" };
+	ConfigV2 msg;
+	aws::protocolparser::Parse(3, const_cast<char **>(argv), &msg);
+	CHECK(msg.GetExtension(ExtensionTest) == 5);
+
+	const char *bare[] = { "test", "--ExtensionTest=6" };
+	aws::protocolparser::Parse(2, const_cast<char **>(bare), &msg);
+	CHECK(msg.GetExtension(ExtensionTest) == 6);
+
+	const std::string buffer = "ExtensionTest=7 [ExtensionTest]=8";
+	ConfigV2 from_buffer;
+	aws::protocolparser::ParseBuffer(buffer.data(), buffer.size(), &from_buffer);
+	CHECK(from_buffer.GetExtension(ExtensionTest) == 8);
+
+	CHECK(aws::protocolparser::GetInt32(&msg, "ExtensionTest") == 6);
+	CHECK(aws::protocolparser::GetInt32(&msg, "[ExtensionTest]") == 6);
+
+	CHECK(aws::protocolparser::Dump(msg, aws::protocolparser::DUMP_HUMAN).find(
+		"`[ExtensionTest]' = `6'") != std::string::npos);
+	CHECK(aws::protocolparser::Dump(msg, aws::protocolparser::DUMP_JSON).find(
+		"\"[ExtensionTest]\":6") != std::string::npos);
+	CHECK(aws::protocolparser::Dump(msg, aws::protocolparser::DUMP_ARGV).find(
+		"--[ExtensionTest]=6\n") != std::string::npos);
+	CheckRoundTrip(msg);
+}
+
+int main() {
+	CheckConfig();
+	CheckExtensions();
+	CheckBytes();
+	CheckDeepNesting();
+	CheckNestingLimit();
+	return TestResult("roundtrip_test");
+}
@@ -0,0 +1,87 @@
+/* SharedConfigReader must only trust its own mapping: a header claiming more
+ * than is mapped must not crash the reader, and a segment the publisher grew
+ * is mapped again.  Segments are private unless the publisher asks otherwise. */
+
+#include <ConfigProtoV2.pb.h>
+
+#include <aws_protoparser.hpp>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "test_common.hpp"
+
+// Permission bits of a segment (0 if it cannot be opened).
+static mode_t SegmentMode(const std::string &name) {
+	int fd = shm_open(name.c_str(), O_RDONLY, 0);
+	if (fd < 0) {
+		return 0;
+	}
+	struct stat st;
+	mode_t mode = fstat(fd, &st) == 0 ? (st.st_mode & 0777) : 0;
+	close(fd);
+	return mode;
+}
+
+int main() {
+	std::string name = "/aws_protoparser_shm_test.";
+	name.append(std::to_string(static_cast<long>(getpid())));
+	ConfigV2 prototype;
+
+	aws::protocolparser::SharedConfigPublisher publisher;
+	CHECK(publisher.Open(name, prototype, 64));
+	CHECK(SegmentMode(name) == 0600);
+	ConfigV2 small;
+	small.set_stringtest("small");
+	CHECK(publisher.Publish(small));
+
+	aws::protocolparser::SharedConfigReader reader;
+	CHECK(reader.Open(name, prototype));
+	ConfigV2 read;
+	CHECK(reader.Read(&read));
+	CHECK_EQ_STR(read.stringtest(), "small");
+
+	// Too large for the segment: refused, the last message stays readable.
+	ConfigV2 large;
+	large.set_stringtest(std::string(100000, 'x'));
+	CHECK(!publisher.Publish(large));
+	CHECK(reader.Read(&read));
+	CHECK_EQ_STR(read.stringtest(), "small");
+
+	// The publisher grows the segment (and opens it to other users); the open reader follows.
+	publisher.Close();
+	CHECK(publisher.Open(name, prototype, 200000, 0644));
+	CHECK(SegmentMode(name) == 0644);
+	CHECK(publisher.Publish(large));
+	CHECK(reader.Read(&read));
+	CHECK(read.stringtest() == large.stringtest());
+
+	// A header rewritten to claim far more than exists must not be followed.
+	int fd = shm_open(name.c_str(), O_RDWR, 0);
+	CHECK(fd >= 0);
+	if (fd >= 0) {
+		void *map = mmap(nullptr, sizeof(aws::protocolparser::detail::SharedConfigHeader),
+			PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		close(fd);
+		CHECK(map != MAP_FAILED);
+		if (map != MAP_FAILED) {
+			aws::protocolparser::detail::SharedConfigHeader *header =
+				static_cast<aws::protocolparser::detail::SharedConfigHeader *>(map);
+			header->capacity = UINT64_MAX / 2;
+			header->size = UINT64_MAX / 4;
+			CHECK(!reader.Read(&read));
+
+			aws::protocolparser::SharedConfigReader fresh;
+			if (fresh.Open(name, prototype)) {
+				CHECK(!fresh.Read(&read));
+			}
+			munmap(map, sizeof(*header));
+		}
+	}
+
+	publisher.Close();
+	CHECK(aws::protocolparser::SharedConfigPublisher::Unlink(name));
+	return TestResult("shm_test");
+}
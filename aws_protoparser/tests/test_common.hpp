@@ -0,0 +1,76 @@
+/* Minimal checks shared by the aws_protoparser tests (no framework needed). */
+
+#ifndef _AWS_PROTOPARSER_TEST_COMMON_HPP_
+#define _AWS_PROTOPARSER_TEST_COMMON_HPP_
+
+#include <google/protobuf/descriptor.pb.h>
+#include <google/protobuf/dynamic_message.h>
+#include <google/protobuf/text_format.h>
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+static int g_test_failures = 0;
+
+#define CHECK(cond) \
+	do { \
+		if (!(cond)) { \
+			fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+			g_test_failures++; \
+		} \
+	} while (0)
+
+#define CHECK_EQ_STR(a, b) \
+	do { \
+		const std::string check_a_ = (a); \
+		const std::string check_b_ = (b); \
+		if (check_a_ != check_b_) { \
+			fprintf(stderr, "%s:%d: %s != %s\n  '%s'\n  '%s'\n", __FILE__, __LINE__, \
+				#a, #b, check_a_.c_str(), check_b_.c_str()); \
+			g_test_failures++; \
+		} \
+	} while (0)
+
+/**
+ * @brief Builds message types at run time from FileDescriptorProto text.
+ * @in files Files in text format, dependencies first.
+ * @in type_name Full name of the message type to return.
+ * @return Prototype of type_name, or nullptr (and a failed check).
+ *
+ * The pool and factory are never destroyed: the parser's metadata caches
+ * keep their descriptors for the life of the process.
+ */
+static const ::google::protobuf::Message *BuildDynamicSchema(
+	const std::vector<std::string> &files, const char *type_name) {
+
+	::google::protobuf::DescriptorPool *pool = new ::google::protobuf::DescriptorPool;
+	for (size_t i = 0; i < files.size(); i++) {
+		::google::protobuf::FileDescriptorProto file;
+		CHECK(::google::protobuf::TextFormat::ParseFromString(files[i], &file));
+		CHECK(pool->BuildFile(file) != nullptr);
+	}
+	const ::google::protobuf::Descriptor *desc = pool->FindMessageTypeByName(type_name);
+	CHECK(desc != nullptr);
+	if (desc == nullptr) {
+		return nullptr;
+	}
+	::google::protobuf::DynamicMessageFactory *factory = new ::google::protobuf::DynamicMessageFactory(pool);
+	factory->SetDelegateToGeneratedFactory(false);
+	return factory->GetPrototype(desc);
+}
+
+static const ::google::protobuf::Message *BuildDynamicSchema(const char *file, const char *type_name) {
+	return BuildDynamicSchema(std::vector<std::string>(1, file), type_name);
+}
+
+static int TestResult(const char *name) {
+	if (g_test_failures != 0) {
+		fprintf(stderr, "%s: %d check(s) failed\n", name, g_test_failures);
+		return 1;
+	}
+	printf("%s: ok\n", name);
+	return 0;
+}
+
+#endif
@@ -0,0 +1,77 @@
+/* Arguments matching no field are kept exactly as given, the same way from
+ * argv, a vector and a buffer; Parse(argc, argv, &msg, 0) stays unambiguous. */
+
+#include <ConfigProtoV2.pb.h>
+
+#include <aws_protoparser.hpp>
+
+#include <vector>
+
+#include "test_common.hpp"
+
+static std::vector<std::string> Strings(const std::vector<aws::protocolparser::ArgumentSlice> &slices) {
+	std::vector<std::string> out;
+	for (size_t i = 0; i < slices.size(); i++) {
+		out.push_back(std::string(slices[i].data, slices[i].len));
+	}
+	return out;
+}
+
+int main() {
+	const char *argv[] = { "test", "--StringTest=a", "--Forward=1", "positional", "--Nested=Int32Test=2" };
+	const int argc = sizeof(argv) / sizeof(argv[0]);
+
+	std::vector<std::string> expected;
+	expected.push_back("--Forward=1");
+	expected.push_back("positional");
+
+	// Used to be ambiguous with the unknown-collecting overload.
+	ConfigV2 plain;
+	aws::protocolparser::Parse(argc, const_cast<char **>(argv), &plain, 0);
+	CHECK_EQ_STR(plain.stringtest(), "a");
+
+	ConfigV2 from_argv;
+	std::vector<aws::protocolparser::ArgumentSlice> unknown;
+	aws::protocolparser::ParseCollectUnknown(argc, const_cast<char **>(argv), &from_argv, &unknown);
+	CHECK(Strings(unknown) == expected);
+	CHECK_EQ_STR(from_argv.DebugString(), plain.DebugString());
+
+	// argv copied into a vector: same message, same unknown arguments.
+	aws::protocolparser::ParserContext ctx;
+	std::vector<std::string> vec(argv + 1, argv + argc);
+	ConfigV2 from_vec;
+	aws::protocolparser::Parse(ctx, vec, &from_vec);
+	CHECK(Strings(ctx.unknown) == expected);
+	CHECK_EQ_STR(from_vec.DebugString(), plain.DebugString());
+
+	// The original vector form (no '--') still works.
+	vec.clear();
+	vec.push_back("StringTest=a");
+	vec.push_back("Nested=Int32Test=2");
+	vec.push_back("Forward=1");
+	ConfigV2 bare;
+	aws::protocolparser::Parse(ctx, vec, &bare);
+	CHECK_EQ_STR(bare.DebugString(), plain.DebugString());
+	CHECK(ctx.unknown.size() == 1 && Strings(ctx.unknown)[0] == "Forward=1");
+
+	const std::string buffer = "--StringTest=a --Forward=1 positional --Nested=Int32Test=2";
+	ConfigV2 from_buffer;
+	aws::protocolparser::ParseBuffer(ctx, buffer.data(), buffer.size(), &from_buffer);
+	CHECK(Strings(ctx.unknown) == expected);
+	CHECK_EQ_STR(from_buffer.DebugString(), plain.DebugString());
+
+	// Passed on through the message's unknown fields (ConfigV2 reserves
+	// 100 and up for extensions; ConfigV2_Nested does not).
+	CHECK(!aws::protocolparser::StoreUnknownArguments(ctx, &from_buffer, 1000));
+	ConfigV2_Nested holder;
+	CHECK(aws::protocolparser::StoreUnknownArguments(ctx, &holder, 1000));
+	const ::google::protobuf::UnknownFieldSet &fields = holder.unknown_fields();
+	CHECK(fields.field_count() == 2);
+	if (fields.field_count() == 2) {
+		CHECK_EQ_STR(fields.field(0).length_delimited(), "--Forward=1");
+		CHECK_EQ_STR(fields.field(1).length_delimited(), "positional");
+	}
+	CHECK(!aws::protocolparser::StoreUnknownArguments(ctx, &holder, 1));
+
+	return TestResult("unknown_test");
+}